@@ -11,113 +11,121 @@
 *
 ******************************************************************************/
 
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 #include "AdaptiveMedianBGS.hpp"
+#include "CpuDispatch.hpp"
+
+// kernel variants: the baseline one is compiled here, the others in AdaptiveMedianBGS.<path>.cpp
+#define BGS_CPU_NAMESPACE cpu_baseline
+#include "AdaptiveMedianBGS.simd.hpp"
+#undef BGS_CPU_NAMESPACE
+
+#define BGS_CPU_DECLARATIONS_ONLY
+#define BGS_CPU_NAMESPACE cpu_sse4_2
+#include "AdaptiveMedianBGS.simd.hpp"
+#undef BGS_CPU_NAMESPACE
+#define BGS_CPU_NAMESPACE cpu_avx2
+#include "AdaptiveMedianBGS.simd.hpp"
+#undef BGS_CPU_NAMESPACE
+#define BGS_CPU_NAMESPACE cpu_avx512
+#include "AdaptiveMedianBGS.simd.hpp"
+#undef BGS_CPU_NAMESPACE
+#undef BGS_CPU_DECLARATIONS_ONLY
 
 using namespace Algorithms::BackgroundSubtraction;
 
-AdaptiveMedianBGS::AdaptiveMedianBGS() :
-    m_i( 0 ),
-    m_low_threshold( 40U ),
-    m_high_threshold( 80U ),
-    m_samplingRate( 7 ),
-    m_learning_frames( 30 )
+namespace
+{
+    // Variant of the kernel for the active instruction set (only built variants can be active).
+    decltype( &cpu_baseline::MedianSubtractUpdateSpan )     MedianKernel()
+    {
+        switch( ActiveCpuPath() )
+        {
+#ifdef BGS_DISPATCH_SSE4_2
+        case CPU_PATH_SSE4_2:
+            return cpu_sse4_2::MedianSubtractUpdateSpan;
+#endif
+#ifdef BGS_DISPATCH_AVX2
+        case CPU_PATH_AVX2:
+            return cpu_avx2::MedianSubtractUpdateSpan;
+#endif
+#ifdef BGS_DISPATCH_AVX512
+        case CPU_PATH_AVX512:
+            return cpu_avx512::MedianSubtractUpdateSpan;
+#endif
+        default:
+            return cpu_baseline::MedianSubtractUpdateSpan;
+        }
+    }
+}
+
+AdaptiveMedianBGS::AdaptiveMedianBGS()
 {}
 
 AdaptiveMedianBGS::~AdaptiveMedianBGS()
 {}
 
-void    AdaptiveMedianBGS::getBackgroundImage( cv::OutputArray backgroundImage ) const
+void    AdaptiveMedianBGS::Initalize( const BgsParams& param )
 {
-    m_median.copyTo( backgroundImage );
+    m_params = dynamic_cast< const AdaptiveMedianParams& >( param );
+
+    // only pixels inside the region of interest are modelled
+    m_size = cv::Size( m_params.Width(), m_params.Height() );
+    m_spans = m_params.Roi().Spans( m_size.width, m_size.height );
+    m_median = m_median_arena.Create( "AdaptiveMedianBGS.median", 1, SpanPixels( m_spans ), m_params.Type() );
+    m_exposed.clear();
+
+    // the next frame passed to apply() initializes the model
+    m_frame_num = 0;
 }
 
-void    AdaptiveMedianBGS::InitModel( const RgbImage& data )
+void    AdaptiveMedianBGS::getBackgroundImage( cv::OutputArray backgroundImage ) const
 {
-    // initialize the background model
-    m_median = data.clone();
+    cv::Mat background;
+    ScatterPixels( m_median, m_spans, m_size, background );
+    background.copyTo( backgroundImage );
 }
 
-void AdaptiveMedianBGS::Update( int frame_num, const RgbImage& data, const BwImage& update_mask )
+void    AdaptiveMedianBGS::InitModel( const BaseImage& data )
 {
-    auto check1 = ( frame_num % m_samplingRate ) == 1;
-    auto check2 = frame_num < m_learning_frames;
-    if( !check1 && !check2 )
-    {
-        return;
-    }
-
-    // update background model
-    data.forEach( [ & ]( auto && color, auto && position ) {
-        auto r = position[ 0 ];
-        auto c = position[ 1 ];
-
-        // perform conditional updating only if we are passed the learning phase
-        auto check1 = update_mask( r, c ) == BACKGROUND;
-        auto check2 = frame_num < m_learning_frames;
-        if( !check1 && !check2 )
-        {
-            return;
-        }
-
-        for( int ch = 0; ch < m_median.channels(); ++ch )
-        {
-            if( data( r, c )[ ch ] > m_median( r, c )[ ch ] )
-            {
-                ++m_median( r, c )[ ch ];
-            }
-            else if( data( r, c )[ ch ] < m_median( r, c )[ ch ] )
-            {
-                --m_median( r, c )[ ch ];
-            }
-        }
-    } );
+    // initialize the background model with the pixels inside the region of interest (in place,
+    // the median lives in pooled memory)
+    GatherPixels( data, m_spans, m_median );
+    m_exposed.clear();
 }
 
-void    AdaptiveMedianBGS::apply( cv::InputArray image, cv::OutputArray fgmask, double learningRate )
+bool    AdaptiveMedianBGS::WarpModel( const cv::Mat& transform )
 {
-    cv::Mat frame_data = image.getMat();
-    if( m_i == 0 )
+    // no model before the first frame
+    if( m_spans.empty() )
     {
-        // initialize background model to first frame of video stream
-        InitModel( frame_data );
+        return true;
     }
 
-    BwImage low_threshold_mask;
-    BwImage high_threshold_mask;
+    std::vector< int > sources;
+    WarpSources( transform, m_spans, m_size, sources );
+    WarpPackedRecords( sources, m_median.elemSize(), m_median );
 
-    Subtract( m_i, frame_data, low_threshold_mask, high_threshold_mask );
+    // exposed pixels take the value of the next frame
+    m_exposed = ExposedSpans( sources, m_spans );
 
-    // update background subtraction
-    Update( m_i, frame_data, low_threshold_mask );
-
-    low_threshold_mask.copyTo( fgmask );
-
-    ++m_i;
+    return true;
 }
 
-void    AdaptiveMedianBGS::SubtractPixel( int r, int c, const RgbPixel & pixel,
-                                          unsigned char & low_threshold,
-                                          unsigned char &  high_threshold )
+void    AdaptiveMedianBGS::apply( cv::InputArray image, cv::OutputArray fgmask, double learningRate )
 {
-    // perform background subtraction
-    low_threshold = FOREGROUND;
-    high_threshold = FOREGROUND;
-
-    int diffR = cv::abs( pixel[ 0 ] - m_median( r, c )[ 0 ] );
-    int diffG = cv::abs( pixel[ 1 ] - m_median( r, c )[ 1 ] );
-    int diffB = cv::abs( pixel[ 2 ] - m_median( r, c )[ 2 ] );
-
-    auto low = m_low_threshold;
-    if( diffR <= low && diffG <= low &&  diffB <= low )
+    if( image.size() != m_size || image.type() != m_params.Type() )
     {
-        low_threshold = BACKGROUND;
+        // allocate the model for the frame size and type
+        m_params.SetFrameSize( image.size().width, image.size().height );
+        m_params.Channels() = image.channels();
+        m_params.Depth() = image.depth();
+        Initalize( m_params );
     }
 
-    auto high = m_high_threshold;
-    if( diffR <= high && diffG <= high &&  diffB <= high )
-    {
-        high_threshold = BACKGROUND;
-    }
+    Bgs::apply( image, fgmask, learningRate );
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -125,32 +133,82 @@ void    AdaptiveMedianBGS::SubtractPixel( int r, int c, const RgbPixel & pixel,
 //  data - a pointer to the image data
 //Output:
 //  output - a pointer to the data of a gray value image
-//					(the memory should already be reserved) 
 //					values: 255-foreground, 0-background
+//
+// The median is updated in the same pass on sampling frames (and on every
+// frame of the learning phase). Past the learning phase only pixels set to
+// background in the low threshold mask are updated.
 ///////////////////////////////////////////////////////////////////////////////
-void AdaptiveMedianBGS::Subtract( int frame_num, const RgbImage& data,
+void AdaptiveMedianBGS::Subtract( int frame_num, const BaseImage& data,
                                   BwImage& low_threshold_mask, BwImage& high_threshold_mask )
 {
-    //ADD CHECK FOR SOME SIZE AND SOME TYPE
-    //ADD CHECK FOR NON EMPTY
-    low_threshold_mask.create( data.size() );
-    high_threshold_mask.create( data.size() );
-
-    // update each pixel of the image
-    data.forEach( [ & ]( auto && color, auto && position ) {
-        auto r = position[ 0 ];
-        auto c = position[ 1 ];
-
-        unsigned char low_threshold, high_threshold;
-        SubtractPixel( r, c, color, low_threshold, high_threshold );
-
-        // setup silhouette mask
-        low_threshold_mask( r, c ) = low_threshold;
-        high_threshold_mask( r, c ) = high_threshold;
-    } );
+    CV_Assert( data.type() == m_params.Type() );
+
+    // pixels outside of the region of interest are background (masks passed to a call
+    // restricted by a process mask already hold the previous, cleared, values)
+    if( !m_params.Roi().Empty() && m_process_mask.empty() )
+    {
+        low_threshold_mask.setTo( BACKGROUND );
+        high_threshold_mask.setTo( BACKGROUND );
+    }
+
+    size_t elem_size = m_median.elemSize();
+    for( const PixelSpan& span : m_exposed )
+    {
+        std::memcpy( m_median.ptr() + span.offset * elem_size, data.ptr( span.row ) + span.begin * elem_size,
+                     ( span.end - span.begin ) * elem_size );
+    }
+    m_exposed.clear();
+
+    // a sampling rate of 1 updates every frame
+    bool learning = frame_num < m_params.LearningFrames();
+    int sampling_rate = FrameSamplingRate( m_params.SamplingRate() );
+    bool update = learning || ( sampling_rate > 0 && frame_num % sampling_rate == 1 % sampling_rate );
+
+    // kernel for the instruction set of the processor, selected once per frame
+    const auto kernel = MedianKernel();
+    auto subtract = [ & ]( const PixelSpan& span, int begin, int end ) {
+        kernel( data.type(), data.ptr( span.row ) + elem_size * begin,
+                m_median.ptr() + elem_size * ( span.offset + begin - span.begin ),
+                low_threshold_mask.ptr< uchar >( span.row ) + begin,
+                high_threshold_mask.ptr< uchar >( span.row ) + begin,
+                end - begin, m_params.LowThreshold(), m_params.HighThreshold(), update, !learning );
+    };
+
+    cv::parallel_for_( cv::Range( 0, static_cast< int >( m_spans.size() ) ), [ & ]( const cv::Range& range ) {
+        for( int i = range.start; i < range.end; ++i )
+        {
+            const PixelSpan& span = m_spans[ i ];
+            if( m_process_mask.empty() )
+            {
+                subtract( span, span.begin, span.end );
+                continue;
+            }
+
+            // split the span into runs of processed pixels
+            const uchar* process = m_process_mask.ptr< uchar >( span.row );
+            for( int c = span.begin; c < span.end; )
+            {
+                while( c < span.end && process[ c ] == 0 )
+                    ++c;
+
+                int begin = c;
+                while( c < span.end && process[ c ] != 0 )
+                    ++c;
+
+                if( c > begin )
+                    subtract( span, begin, c );
+            }
+        }
+    }, ParallelStripes() );
+}
+
+void    AdaptiveMedianBGS::Update( int frame_num, const BaseImage& data, const BwImage& update_mask )
+{
+    // the median is updated by Subtract() in the same pass
 }
 
-cv::Ptr< AdaptiveMedianBGS > Algorithms::BackgroundSubtraction::createAdaptiveMedianBGS( unsigned char low_threshold, unsigned char high_threshold, int samplingRate, int learning_frames )
+cv::Ptr< AdaptiveMedianBGS > Algorithms::BackgroundSubtraction::createAdaptiveMedianBGS( float low_threshold, float high_threshold, int samplingRate, int learning_frames )
 {
     cv::Ptr< AdaptiveMedianBGS > bgs( new AdaptiveMedianBGS() );
     bgs->setLowThreshold( low_threshold );
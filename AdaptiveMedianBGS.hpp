@@ -25,6 +25,10 @@
 * 						by McFarlane and Schofield
 *
 * Author: Donovan Parks, September 2007
+*
+* The thresholds and the step the median moves by on each update are in frame
+* values: thresholds of 16 bit frames range up to 65535, and float frames are
+* expected to be scaled to the 0-255 range.
 
 Example:
     auto bgs = Algorithms::BackgroundSubtraction::createAdaptiveMedianBGS();
@@ -40,54 +44,87 @@ Example:
 #ifndef _ADAPTIVE_MEDIAN_BGS_H_		
 #define _ADAPTIVE_MEDIAN_BGS_H_		
 
-#include <opencv2/video.hpp>
-#include "Image.hpp"
+#include "Bgs.hpp"
 
 namespace Algorithms
 {
     namespace BackgroundSubtraction
     {
 
+        // --- User adjustable parameters used by the adaptive median BGS algorithm ---
+        class AdaptiveMedianParams : public BgsParams
+        {
+        public:
+            AdaptiveMedianParams() :
+                m_low_threshold( 40.0f ),
+                m_high_threshold( 80.0f ),
+                m_samplingRate( 7 ),
+                m_learning_frames( 30 )
+            {}
+
+            float           &LowThreshold() { return m_low_threshold; }
+            float           &HighThreshold() { return m_high_threshold; }
+            int             &SamplingRate() { return m_samplingRate; }
+            int             &LearningFrames() { return m_learning_frames; }
+
+            float           LowThreshold() const { return m_low_threshold; }
+            float           HighThreshold() const { return m_high_threshold; }
+            int             SamplingRate() const { return m_samplingRate; }
+            int             LearningFrames() const { return m_learning_frames; }
+
+        private:
+            float           m_low_threshold;
+            float           m_high_threshold;
+            int             m_samplingRate;
+            int             m_learning_frames;
+        };
+
         // --- Adaptive Median BGS algorithm ---
-        class AdaptiveMedianBGS : public cv::BackgroundSubtractor
+        class AdaptiveMedianBGS : public Bgs
         {
         public:
             AdaptiveMedianBGS();
             ~AdaptiveMedianBGS();
 
-            void    setLowThreshold( unsigned char low_threshold ) { m_low_threshold = low_threshold; }
-            void    setHighThreshold( unsigned char high_threshold ) { m_high_threshold = high_threshold; }
-            void    setSamplingRate( int samplingRate ) { m_samplingRate = samplingRate; }
-            void    setLearningFrames( int learning_frames ) { m_learning_frames = learning_frames; }
+            void    Initalize( const BgsParams& param );
+
+            void    InitModel( const BaseImage& data );
+            bool    WarpModel( const cv::Mat& transform );
+            // The model is updated in the same pass, so Update() does nothing.
+            void    Subtract( int frame_num, const BaseImage& data,
+                              BwImage& low_threshold_mask, BwImage& high_threshold_mask );
+            void    Update( int frame_num, const BaseImage& data, const BwImage& update_mask );
+
+            void    setLowThreshold( float low_threshold ) { m_params.LowThreshold() = low_threshold; }
+            void    setHighThreshold( float high_threshold ) { m_params.HighThreshold() = high_threshold; }
+            void    setSamplingRate( int samplingRate ) { m_params.SamplingRate() = samplingRate; }
+            void    setLearningFrames( int learning_frames ) { m_params.LearningFrames() = learning_frames; }
+            // The model is rebuilt from the next frame when the region of interest changes.
+            void    setRegionOfInterest( const RegionOfInterest& roi ) { m_params.Roi() = roi; m_size = cv::Size(); }
 
-            unsigned char   getLowThreshold() const { return m_low_threshold; }
-            unsigned char   getHighThreshold() const { return m_high_threshold; }
-            int             getSamplingRate() const { return m_samplingRate; }
-            int             getLearningFrames() const { return m_learning_frames; }
+            float           getLowThreshold() const { return m_params.LowThreshold(); }
+            float           getHighThreshold() const { return m_params.HighThreshold(); }
+            int             getSamplingRate() const { return m_params.SamplingRate(); }
+            int             getLearningFrames() const { return m_params.LearningFrames(); }
+            const RegionOfInterest& getRegionOfInterest() const { return m_params.Roi(); }
 
+            // Initializes the model for the size of the first frame if Initalize() was not called.
             void    apply( cv::InputArray image, cv::OutputArray fgmask, double learningRate = -1 );
             void    getBackgroundImage( cv::OutputArray backgroundImage ) const;
 
         private:
-            void    InitModel( const RgbImage& data );
-            void    SubtractPixel( int r, int c, const RgbPixel & pixel,
-                                   unsigned char & low_threshold, unsigned char & high_threshold );
-            void    Subtract( int frame_num, const RgbImage& data,
-                              BwImage& low_threshold_mask, BwImage& high_threshold_mask );
-            void    Update( int frame_num, const RgbImage& data, const BwImage& update_mask );
-
-            int             m_i;
-            unsigned char   m_low_threshold;
-            unsigned char   m_high_threshold;
-            int             m_samplingRate;
-            int             m_learning_frames;
-            RgbImage        m_median;
+            AdaptiveMedianParams    m_params;
+            PixelSpans      m_spans;
+            cv::Size        m_size;
+            ModelArena      m_median_arena;
+            BaseImage       m_median;       // packed median of the pixels in m_spans
+            PixelSpans      m_exposed;      // pixels exposed by WarpModel(), set from the next frame
 
         };
 
         //Note: high threshold is used by post - processing
         cv::Ptr< AdaptiveMedianBGS >    createAdaptiveMedianBGS(
-            unsigned char low_threshold = 40U, unsigned char high_threshold = 80U,
+            float low_threshold = 40.0f, float high_threshold = 80.0f,
             int samplingRate = 7, int learning_frames = 30 );
 
     };
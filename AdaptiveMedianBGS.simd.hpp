@@ -0,0 +1,283 @@
+/****************************************************************************
+*
+*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+******************************************************************************/
+
+/****************************************************************************
+*
+* AdaptiveMedianBGS.simd.hpp
+*
+* Purpose: Subtraction and update kernel of AdaptiveMedianBGS. The file is
+*          compiled once per instruction set of CpuDispatch.hpp, each time
+*          with BGS_CPU_NAMESPACE naming the namespace of the variant and the
+*          compiler flags and OpenCV CV_CPU_* definitions of the instruction
+*          set, so the universal intrinsics use the widest registers
+*          available. Defining BGS_CPU_DECLARATIONS_ONLY declares the variant
+*          without compiling it. Code in this file must not call inline
+*          functions shared with other translation units (including std::
+*          helpers), since the linker could pick a copy compiled for a newer
+*          instruction set.
+
+Example:
+    #define BGS_CPU_NAMESPACE cpu_avx2
+    #include "AdaptiveMedianBGS.simd.hpp"
+******************************************************************************/
+
+// no include guard: included once per variant
+
+#include <opencv2/core/hal/intrin.hpp>
+#include "Image.hpp"
+
+namespace Algorithms
+{
+    namespace BackgroundSubtraction
+    {
+        namespace BGS_CPU_NAMESPACE
+        {
+
+        // Subtract a run of width pixels of the given type (8U, 16U or 32F with 1, 2 or 3 channels)
+        // from the median and, if update is set, nudge the median towards them. See AdaptiveMedianBGS.
+        void    MedianSubtractUpdateSpan( int type, const uchar* data, uchar* median, uchar* low_mask, uchar* high_mask,
+                                          int width, float low_threshold, float high_threshold, bool update, bool conditional );
+
+#ifndef BGS_CPU_DECLARATIONS_ONLY
+
+        namespace
+        {
+#if CV_SIMD
+            // Universal intrinsics for the channel types of the frames. A block of v_uint8::nlanes
+            // pixels is processed per step, which spans 1, 2 or 4 registers of the channel type.
+            inline cv::v_uint8      SetAll( uchar value ) { return cv::vx_setall_u8( value ); }
+            inline cv::v_uint16     SetAll( ushort value ) { return cv::vx_setall_u16( value ); }
+            inline cv::v_float32    SetAll( float value ) { return cv::vx_setall_f32( value ); }
+
+            // Pack the comparison results of a block (all bits set or clear per lane) into 0/255 bytes.
+            inline cv::v_uint8  PackMask( const cv::v_uint8* mask )
+            {
+                return mask[ 0 ];
+            }
+
+            inline cv::v_uint8  PackMask( const cv::v_uint16* mask )
+            {
+                return cv::v_pack_b( mask[ 0 ], mask[ 1 ] );
+            }
+
+            inline cv::v_uint8  PackMask( const cv::v_float32* mask )
+            {
+                return cv::v_pack_b( cv::v_reinterpret_as_u32( mask[ 0 ] ), cv::v_reinterpret_as_u32( mask[ 1 ] ),
+                                     cv::v_reinterpret_as_u32( mask[ 2 ] ), cv::v_reinterpret_as_u32( mask[ 3 ] ) );
+            }
+
+            // Nudge the medians one step towards the pixels. Medians set in skip are kept.
+            template< typename V >
+            inline V    NudgeMedian( const V& pixel, const V& median, const V& skip, const V& one )
+            {
+                return cv::v_select( skip, median,
+                                     cv::v_select( pixel > median, median + one,
+                                                   cv::v_select( pixel < median, median - one, median ) ) );
+            }
+#endif
+
+            // Subtract a run of pixels with CN (1, 2 or 3) channels of type T from the median model and,
+            // if requested, nudge the median one step towards the new data. Masks are written as 0/255,
+            // so the packed comparison results can be stored directly (FOREGROUND == 255, BACKGROUND == 0).
+            // Pixels marked as foreground in the low threshold mask are only updated when conditional
+            // is false.
+            template< typename T, int CN >
+            void    SubtractUpdateSpan( const T* data, T* median, uchar* low_mask, uchar* high_mask, int width,
+                                       T low_threshold, T high_threshold, bool update, bool conditional )
+            {
+                int c = 0;
+
+#if CV_SIMD
+                if( cv::useOptimized() )
+                {
+                    typedef decltype( cv::vx_load( data ) ) V;
+                    const int lanes = V::nlanes;
+                    const int regs = cv::v_uint8::nlanes / lanes;
+                    const V v_low = SetAll( low_threshold );
+                    const V v_high = SetAll( high_threshold );
+                    const V v_zero = SetAll( T( 0 ) );
+                    const V v_one = SetAll( T( 1 ) );
+
+                    for( ; c <= width - cv::v_uint8::nlanes; c += cv::v_uint8::nlanes )
+                    {
+                        V low[ 4 ], high[ 4 ];
+
+                        for( int i = 0; i < regs; ++i )
+                        {
+                            const int x = c + i * lanes;
+
+                            if( CN == 1 )
+                            {
+                                V p = cv::vx_load( data + x );
+                                V m = cv::vx_load( median + x );
+
+                                V diff = cv::v_absdiff( p, m );
+                                low[ i ] = diff > v_low;
+                                high[ i ] = diff > v_high;
+
+                                if( update )
+                                {
+                                    cv::v_store( median + x, NudgeMedian( p, m, conditional ? low[ i ] : v_zero, v_one ) );
+                                }
+                            }
+                            else if( CN == 2 )
+                            {
+                                V u, v, mu, mv;
+                                cv::v_load_deinterleave( data + 2 * x, u, v );
+                                cv::v_load_deinterleave( median + 2 * x, mu, mv );
+
+                                V diff = cv::v_max( cv::v_absdiff( u, mu ), cv::v_absdiff( v, mv ) );
+                                low[ i ] = diff > v_low;
+                                high[ i ] = diff > v_high;
+
+                                if( update )
+                                {
+                                    V skip = conditional ? low[ i ] : v_zero;
+                                    cv::v_store_interleave( median + 2 * x, NudgeMedian( u, mu, skip, v_one ),
+                                                            NudgeMedian( v, mv, skip, v_one ) );
+                                }
+                            }
+                            else
+                            {
+                                V b, g, r, mb, mg, mr;
+                                cv::v_load_deinterleave( data + 3 * x, b, g, r );
+                                cv::v_load_deinterleave( median + 3 * x, mb, mg, mr );
+
+                                // L-inf distance between pixel and median
+                                V diff = cv::v_max( cv::v_absdiff( b, mb ),
+                                                    cv::v_max( cv::v_absdiff( g, mg ), cv::v_absdiff( r, mr ) ) );
+                                low[ i ] = diff > v_low;
+                                high[ i ] = diff > v_high;
+
+                                if( update )
+                                {
+                                    V skip = conditional ? low[ i ] : v_zero;
+                                    cv::v_store_interleave( median + 3 * x, NudgeMedian( b, mb, skip, v_one ),
+                                                            NudgeMedian( g, mg, skip, v_one ), NudgeMedian( r, mr, skip, v_one ) );
+                                }
+                            }
+                        }
+
+                        cv::v_store( low_mask + c, PackMask( low ) );
+                        cv::v_store( high_mask + c, PackMask( high ) );
+                    }
+                    cv::vx_cleanup();
+                }
+#endif
+
+                for( ; c < width; ++c )
+                {
+                    const T* pixel = data + CN * c;
+                    T* model = median + CN * c;
+
+                    T diff = 0;
+                    for( int ch = 0; ch < CN; ++ch )
+                    {
+                        T channel_diff = pixel[ ch ] > model[ ch ] ? T( pixel[ ch ] - model[ ch ] ) : T( model[ ch ] - pixel[ ch ] );
+                        diff = channel_diff > diff ? channel_diff : diff;
+                    }
+
+                    low_mask[ c ] = diff > low_threshold ? FOREGROUND : BACKGROUND;
+                    high_mask[ c ] = diff > high_threshold ? FOREGROUND : BACKGROUND;
+
+                    if( !update || ( conditional && low_mask[ c ] == FOREGROUND ) )
+                    {
+                        continue;
+                    }
+
+                    for( int ch = 0; ch < CN; ++ch )
+                    {
+                        if( pixel[ ch ] > model[ ch ] )
+                        {
+                            ++model[ ch ];
+                        }
+                        else if( pixel[ ch ] < model[ ch ] )
+                        {
+                            --model[ ch ];
+                        }
+                    }
+                }
+            }
+
+            // Threshold on the differences of frames of the unsigned type T. An integer difference exceeds
+            // a threshold exactly when it exceeds its integer part, which is saturated to the range of T.
+            template< typename T >
+            inline T    DifferenceThreshold( float threshold )
+            {
+                const T largest = static_cast< T >( ~0u );
+                if( threshold <= 0 )
+                    return 0;
+                if( threshold >= largest )
+                    return largest;
+                return static_cast< T >( static_cast< int >( threshold ) );
+            }
+
+            template<>
+            inline float    DifferenceThreshold< float >( float threshold )
+            {
+                return threshold;
+            }
+
+            template< typename T >
+            void    SubtractUpdateSpanCn( int channels, const uchar* data, uchar* median, uchar* low_mask, uchar* high_mask,
+                                          int width, float low_threshold, float high_threshold, bool update, bool conditional )
+            {
+                const T* pixels = reinterpret_cast< const T* >( data );
+                T* medians = reinterpret_cast< T* >( median );
+                const T low = DifferenceThreshold< T >( low_threshold );
+                const T high = DifferenceThreshold< T >( high_threshold );
+
+                switch( channels )
+                {
+                case 1:
+                    SubtractUpdateSpan< T, 1 >( pixels, medians, low_mask, high_mask, width, low, high, update, conditional );
+                    break;
+                case 2:
+                    SubtractUpdateSpan< T, 2 >( pixels, medians, low_mask, high_mask, width, low, high, update, conditional );
+                    break;
+                default:
+                    SubtractUpdateSpan< T, 3 >( pixels, medians, low_mask, high_mask, width, low, high, update, conditional );
+                    break;
+                }
+            }
+        }
+
+        void    MedianSubtractUpdateSpan( int type, const uchar* data, uchar* median, uchar* low_mask, uchar* high_mask,
+                                          int width, float low_threshold, float high_threshold, bool update, bool conditional )
+        {
+            switch( CV_MAT_DEPTH( type ) )
+            {
+            case CV_8U:
+                SubtractUpdateSpanCn< uchar >( CV_MAT_CN( type ), data, median, low_mask, high_mask, width,
+                                               low_threshold, high_threshold, update, conditional );
+                break;
+            case CV_16U:
+                SubtractUpdateSpanCn< ushort >( CV_MAT_CN( type ), data, median, low_mask, high_mask, width,
+                                                low_threshold, high_threshold, update, conditional );
+                break;
+            default:
+                SubtractUpdateSpanCn< float >( CV_MAT_CN( type ), data, median, low_mask, high_mask, width,
+                                               low_threshold, high_threshold, update, conditional );
+                break;
+            }
+        }
+
+#endif
+
+        };
+    };
+};
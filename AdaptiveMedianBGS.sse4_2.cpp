@@ -0,0 +1,23 @@
+/****************************************************************************
+*
+*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+******************************************************************************/
+
+// AdaptiveMedianBGS kernel for the sse4_2 path, built with the flags of the path (see CMakeLists.txt)
+
+#ifdef BGS_DISPATCH_SSE4_2
+#define BGS_CPU_NAMESPACE cpu_sse4_2
+#include "AdaptiveMedianBGS.simd.hpp"
+#endif
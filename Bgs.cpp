@@ -0,0 +1,137 @@
+/****************************************************************************
+*
+*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+******************************************************************************/
+
+#include <atomic>
+#include "Bgs.hpp"
+
+using namespace Algorithms::BackgroundSubtraction;
+
+void Bgs::apply(cv::InputArray image, cv::OutputArray fgmask, double learningRate)
+{
+	CV_Assert(image.depth() == CV_8U || image.depth() == CV_16U || image.depth() == CV_32F);
+	BaseImage data = image.getMat();
+
+	BgsStatsRecorder* stats = m_stats.get();
+	StageTimer frame_timer(stats, &BgsStats::frame);
+
+	// initialize background model to first frame of video stream
+	if(m_frame_num == 0)
+	{
+		InitModel(data);
+	}
+
+	// learning rate of this frame
+	if(learningRate >= 0)
+		m_learning_rate = learningRate;
+	else if(m_schedule.Enabled())
+		m_learning_rate = m_schedule.Rate(m_frame_num);
+	else
+		m_learning_rate = -1;
+
+	// the masks of a published frame are written straight into its snapshot
+	int snapshot = -1;
+	if(m_snapshot_interval > 0 && m_frame_num % m_snapshot_interval == 0)
+		snapshot = AcquireSnapshotBuffer();
+	BwImage& low_threshold_mask = snapshot < 0 ? m_mask_buffers[0] : m_snapshot_buffers[snapshot]->low_threshold_mask;
+	BwImage& high_threshold_mask = snapshot < 0 ? m_mask_buffers[1] : m_snapshot_buffers[snapshot]->high_threshold_mask;
+
+	cv::Size size = MaskSize(data);
+	if(low_threshold_mask.size() != size)
+	{
+		low_threshold_mask.create(size);
+		low_threshold_mask.setTo(BACKGROUND);
+		high_threshold_mask.create(size);
+		high_threshold_mask.setTo(BACKGROUND);
+	}
+
+	if(low_threshold_mask.data != m_low_threshold_mask.data)
+	{
+		// masks keep their values between frames for algorithms restricted by a process mask
+		if(!m_process_mask.empty() && m_low_threshold_mask.size() == size)
+		{
+			m_low_threshold_mask.copyTo(low_threshold_mask);
+			m_high_threshold_mask.copyTo(high_threshold_mask);
+		}
+		m_low_threshold_mask = low_threshold_mask;
+		m_high_threshold_mask = high_threshold_mask;
+	}
+
+	{
+		StageTimer timer(stats, &BgsStats::subtract);
+		Subtract(m_frame_num, data, m_low_threshold_mask, m_high_threshold_mask);
+	}
+
+	{
+		StageTimer timer(stats, &BgsStats::update);
+		Update(m_frame_num, data, m_low_threshold_mask);
+	}
+
+	m_low_threshold_mask.copyTo(fgmask);
+
+	if(snapshot >= 0)
+	{
+		PublishSnapshot(snapshot);
+	}
+
+	++m_frame_num;
+}
+
+int Bgs::AcquireSnapshotBuffer()
+{
+	// A buffer only referenced from here is neither published nor held by a reader. No reader can
+	// acquire a new reference to an unpublished buffer, so the count cannot grow again.
+	int free = -1;
+	for(int i = 0; i < 2 && free < 0; ++i)
+	{
+		if(!m_snapshot_buffers[i] || m_snapshot_buffers[i].use_count() == 1)
+			free = i;
+	}
+
+	if(free < 0)
+	{
+		// readers still hold both buffers: leave the unpublished one to them
+		free = m_published_buffer == 0 ? 1 : 0;
+		m_snapshot_buffers[free].reset();
+	}
+
+	if(!m_snapshot_buffers[free])
+	{
+		m_snapshot_buffers[free] = std::make_shared<BgsSnapshot>();
+	}
+	else
+	{
+		// pairs with the release of the reference dropped by the last reader
+		std::atomic_thread_fence(std::memory_order_acquire);
+	}
+
+	return free;
+}
+
+void Bgs::PublishSnapshot(int buffer)
+{
+	BgsSnapshot& snapshot = *m_snapshot_buffers[buffer];
+	snapshot.frame_num = m_frame_num;
+
+	// the background is only built on request, and an old one is not left in a recycled buffer
+	if(m_background_requested.exchange(false, std::memory_order_relaxed))
+		getBackgroundImage(snapshot.background);
+	else
+		snapshot.background.release();
+
+	std::atomic_store(&m_snapshot, std::shared_ptr<const BgsSnapshot>(m_snapshot_buffers[buffer]));
+	m_published_buffer = buffer;
+}
@@ -28,20 +28,64 @@
 #ifndef BGS_H_
 #define BGS_H_
 
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <opencv2/video.hpp>
 #include "Image.hpp"
 #include "BgsParams.hpp"
+#include "BgsStats.hpp"
+#include "ModelPool.hpp"
 
 namespace Algorithms
 {
 namespace BackgroundSubtraction
 {
 
-class Bgs
+// --- Learning rate as a function of the frames since the model was initialized ---
+class LearningRateSchedule
+{
+public:
+	// No schedule: algorithms use the learning rate of their parameters.
+	LearningRateSchedule() : m_steady(-1), m_warm_up(false) {}
+
+	// The same rate for every frame.
+	static LearningRateSchedule Constant(double rate) { return LearningRateSchedule(rate, false); }
+
+	// Fast warm-up: frame n is learned with a rate of max(steady, 1/(n+1)), so the model starts as the
+	// average of all frames seen so far and settles to steady after about 1/steady frames.
+	static LearningRateSchedule WarmUp(double steady) { return LearningRateSchedule(steady, true); }
+
+	bool Enabled() const { return m_steady >= 0; }
+	double Rate(int frame) const { return m_warm_up ? std::max(m_steady, 1.0 / (frame + 1)) : m_steady; }
+
+private:
+	LearningRateSchedule(double steady, bool warm_up) : m_steady(steady), m_warm_up(warm_up) {}
+
+	double m_steady;
+	bool m_warm_up;
+};
+
+// --- Output of one frame, published for other threads ---
+struct BgsSnapshot
+{
+	int frame_num;
+	BwImage low_threshold_mask;
+	BwImage high_threshold_mask;
+
+	// Background of the frame, only built for snapshots published after a reader asked for it with
+	// Bgs::GetSnapshot(true), and empty otherwise.
+	BaseImage background;
+};
+
+class Bgs : public cv::BackgroundSubtractor
 {
 public:
 	static const int BACKGROUND = 0;
 	static const int FOREGROUND = 255;
+	static const int SHADOW = 125;		// foreground explained by a darkened background (GMM algorithms)
 
+	Bgs() : m_learning_rate(-1), m_snapshot_interval(0), m_published_buffer(-1), m_background_requested(false), m_serial(false), m_frame_num(0) {}
 	virtual ~Bgs() {}
 
 	// Initialize any data required by the BGS algorithm. Should be called once before calling
@@ -50,18 +94,151 @@ public:
 
 	// Initialize the background model. Typically, the background model is initialized using the first
 	// frame of the incoming video stream, but alternatives are possible.
-	virtual void InitModel(const RgbImage& data) = 0;
+	virtual void InitModel(const BaseImage& data) = 0;
 
 	// Subtract the current frame from the background model and produce a binary foreground mask using
 	// both a low and high threshold value.
-	virtual void Subtract(int frame_num, const RgbImage& data,  
+	virtual void Subtract(int frame_num, const BaseImage& data,  
 													BwImage& low_threshold_mask, BwImage& high_threshold_mask) = 0;	
 
 	// Update the background model. Only pixels set to background in update_mask are updated.
-	virtual void Update(int frame_num, const RgbImage& data,  const BwImage& update_mask) = 0;
+	virtual void Update(int frame_num, const BaseImage& data,  const BwImage& update_mask) = 0;
 
-	// Return the current background model.
+	// Return the current background model. The image may share memory with the model, so it is only
+	// valid on the thread calling apply(); other threads read published snapshots.
     virtual void    getBackgroundImage( cv::OutputArray backgroundImage ) const = 0;
+
+	// cv::BackgroundSubtractor interface to an initialized algorithm. The model is initialized with
+	// the first frame. Each frame is subtracted and the model is updated with the pixels set to
+	// background in the low threshold mask, which is returned as the foreground mask. A learningRate
+	// between 0 and 1 overrides the learning rate of the frame, a negative one uses the schedule or,
+	// without one, the parameters of the algorithm.
+	virtual void apply(cv::InputArray image, cv::OutputArray fgmask, double learningRate = -1);
+
+	// Follow a global camera motion (e.g. of a PTZ camera) before the next frame is passed to apply().
+	// transform is a 2x3 affine (a translation is [1 0 dx; 0 1 dy]) or 3x3 perspective matrix mapping
+	// pixels of the previous frame to the next one. The per-pixel model moves with the scene and the
+	// pixels exposed by the motion are initialized from the next frame. Models moved before their
+	// first frame are initialized from it as usual. Decorators forward the motion
+	// to the algorithms they wrap. Algorithms that can not warp their model initialize the whole model
+	// again from the next frame and return false.
+	virtual bool WarpModel(const cv::Mat& transform) { m_frame_num = 0; return false; }
+
+	// Whether Subtract() has to see every pixel of frame frame_num, e.g. while the model is built from
+	// a history of whole frames. Decorators that restrict or skip the processed pixels (FrameSkipBgs)
+	// pass such frames on in full. Decorators forward the question to the algorithms they wrap.
+	virtual bool NeedsFullFrame(int frame_num) const { return false; }
+
+	// Learning rate of each frame passed to apply() without a learningRate, by the number of frames
+	// since the model was initialized.
+	void SetLearningRateSchedule(const LearningRateSchedule& schedule) { m_schedule = schedule; }
+
+	// Learning rate of the following calls to Subtract() and Update() (negative for the rate of the
+	// parameters). apply() sets it for every frame.
+	void SetLearningRate(double rate) { m_learning_rate = rate; }
+
+	// Restrict the following calls to Subtract() and Update() to pixels set to a non-zero value in 
+	// the mask. The model of all other pixels is left untouched and so are their values in the
+	// output masks. An empty mask (the default) processes every pixel.
+	void SetProcessMask(const BwImage& mask) { m_process_mask = mask; }
+
+	// Run the loops of the algorithm on the thread calling apply() instead of OpenCV's thread pool,
+	// e.g. on a thread pinned to the NUMA node holding the model. OpenCV functions called by the
+	// algorithm still use the pool (see cv::setNumThreads()).
+	void SetSerial(bool serial) { m_serial = serial; }
+
+	// Masks of the last call to apply(). The low threshold mask is the returned foreground mask.
+	const BwImage& LowThresholdMask() const { return m_low_threshold_mask; }
+	const BwImage& HighThresholdMask() const { return m_high_threshold_mask; }
+
+	// Collect latency statistics of the stages of apply() and algorithm specific counters. Statistics
+	// are disabled by default and cost one pointer test per stage while disabled. Enabling them
+	// again starts a new collection.
+	void EnableStats(bool enable) { m_stats = enable ? cv::makePtr<BgsStatsRecorder>() : cv::Ptr<BgsStatsRecorder>(); }
+	bool StatsEnabled() const { return !m_stats.empty(); }
+
+	// Copy of the statistics collected so far (empty if disabled). May be called from any thread.
+	BgsStats GetStats() const { return m_stats.empty() ? BgsStats() : m_stats->Snapshot(); }
+	void ResetStats() { if(!m_stats.empty()) m_stats->Reset(); }
+
+	// Publish a snapshot of the masks after every interval-th frame passed to apply() (0, the default,
+	// publishes nothing). Subtract() writes the masks of a published frame straight into an unused
+	// snapshot, which then replaces the published one by swapping a pointer, so readers never see a
+	// torn frame, never block apply() and cost no copy of the frame. Only algorithms restricted by a
+	// process mask copy the masks of the previous frame into the snapshot first, since they keep the
+	// values of the pixels they skip.
+	void EnableSnapshots(int interval) { m_snapshot_interval = interval; }
+
+	// Latest published snapshot (NULL before the first one). May be called from any thread. With
+	// background set, the next published snapshot also holds the background of its frame. Building
+	// it costs about as much as a frame for models computing their background on request, so it is
+	// only built when asked for.
+	std::shared_ptr<const BgsSnapshot> GetSnapshot(bool background = false) const
+	{
+		if(background)
+			m_background_requested.store(true, std::memory_order_relaxed);
+		return std::atomic_load(&m_snapshot);
+	}
+
+protected:
+	// Size of the masks for a frame. Algorithms taking frames that pack several planes into
+	// one buffer return the size of the image the planes describe.
+	virtual cv::Size MaskSize(const BaseImage& data) const { return data.size(); }
+
+	// Stripes to split a cv::parallel_for_ loop into: a single one runs it on the calling thread.
+	double ParallelStripes() const { return m_serial ? 1 : -1; }
+
+	bool IsProcessed(int r, int c) const { return m_process_mask.empty() || m_process_mask(r, c) != 0; }
+
+	// Learning rate of the current frame for algorithms blending each frame into the model with
+	// a rate alpha: the rate set for the frame, otherwise alpha.
+	float FrameAlpha(float alpha) const { return m_learning_rate < 0 ? alpha : (float)m_learning_rate; }
+
+	// Same for algorithms learning every sampling_rate-th frame: a rate r learns every 1/r-th frame.
+	// Returns 0 if no frame is learned.
+	int FrameSamplingRate(int sampling_rate) const
+	{
+		if(m_learning_rate < 0)
+			return sampling_rate;
+		return m_learning_rate > 0 ? std::max(cvRound(1.0 / m_learning_rate), 1) : 0;
+	}
+
+	// Index of a snapshot buffer no reader holds, for the masks of the current frame.
+	int AcquireSnapshotBuffer();
+
+	// Complete a snapshot buffer holding the masks of the current frame and publish it.
+	void PublishSnapshot(int buffer);
+
+	BwImage m_process_mask;
+
+	// Learning rate of the current frame (negative for the rate of the parameters) and the schedule
+	// that sets it. Eigenbackground builds its eigenspace once and has no learning rate.
+	double m_learning_rate;
+	LearningRateSchedule m_schedule;
+
+	// Statistics recorder, NULL while statistics are disabled
+	cv::Ptr<BgsStatsRecorder> m_stats;
+
+	// Snapshot publication: frames between snapshots (0 if disabled), the published snapshot (only
+	// accessed with std::atomic_load and std::atomic_store), the buffers recycled for it, the index of
+	// the published buffer (-1 if none, only used by apply()) and whether a reader asked for a background
+	int m_snapshot_interval;
+	std::shared_ptr<const BgsSnapshot> m_snapshot;
+	std::shared_ptr<BgsSnapshot> m_snapshot_buffers[2];
+	int m_published_buffer;
+	mutable std::atomic<bool> m_background_requested;
+
+	// Run loops on the thread calling apply() (see SetSerial())
+	bool m_serial;
+
+	// Number of frames passed to apply() since the model was initialized
+	int m_frame_num;
+
+	// Masks of the current frame. They share the memory of a snapshot buffer for published frames
+	// and of the mask buffers otherwise.
+	BwImage m_low_threshold_mask;
+	BwImage m_high_threshold_mask;
+	BwImage m_mask_buffers[2];
 };
 
 };
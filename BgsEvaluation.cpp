@@ -0,0 +1,137 @@
+/****************************************************************************
+*
+*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+******************************************************************************/
+
+#include <cstdio>
+#include "Bgs.hpp"
+#include "BgsEvaluation.hpp"
+
+using namespace Algorithms::BackgroundSubtraction;
+
+namespace
+{
+    const uint64_t FNV_OFFSET_BASIS = 0xCBF29CE484222325ULL;
+    const uint64_t FNV_PRIME = 0x100000001B3ULL;
+
+    double  Ratio( uint64_t numerator, uint64_t denominator )
+    {
+        return denominator == 0 ? 0 : static_cast< double >( numerator ) / denominator;
+    }
+}
+
+ConfusionMatrix::ConfusionMatrix()
+{
+    Reset();
+}
+
+void    ConfusionMatrix::Add( const BwImage& mask, const BwImage& truth )
+{
+    CV_Assert( mask.size() == truth.size() );
+
+    for( int r = 0; r < mask.rows; ++r )
+    {
+        const uchar* detected = mask.ptr< uchar >( r );
+        const uchar* label = truth.ptr< uchar >( r );
+
+        for( int c = 0; c < mask.cols; ++c )
+        {
+            // shadow labels are background
+            bool foreground = detected[ c ] != 0 && detected[ c ] != Bgs::SHADOW;
+
+            switch( label[ c ] )
+            {
+            case GT_MOTION:
+                foreground ? ++m_tp : ++m_fn;
+                break;
+            case GT_STATIC:
+            case GT_SHADOW:
+                foreground ? ++m_fp : ++m_tn;
+                break;
+            default:
+                // outside of the region of interest or unknown motion
+                break;
+            }
+        }
+    }
+}
+
+void    ConfusionMatrix::Reset()
+{
+    m_tp = 0;
+    m_fp = 0;
+    m_fn = 0;
+    m_tn = 0;
+}
+
+double  ConfusionMatrix::Precision() const
+{
+    return Ratio( m_tp, m_tp + m_fp );
+}
+
+double  ConfusionMatrix::Recall() const
+{
+    return Ratio( m_tp, m_tp + m_fn );
+}
+
+double  ConfusionMatrix::FMeasure() const
+{
+    double precision = Precision();
+    double recall = Recall();
+    return precision + recall == 0 ? 0 : 2 * precision * recall / ( precision + recall );
+}
+
+double  ConfusionMatrix::PWC() const
+{
+    return 100 * Ratio( m_fn + m_fp, m_tp + m_fp + m_fn + m_tn );
+}
+
+ImageDigest::ImageDigest()
+{
+    Reset();
+}
+
+void    ImageDigest::Add( const cv::Mat& image )
+{
+    int header[ 3 ] = { image.type(), image.rows, image.cols };
+    AddBytes( header, sizeof( header ) );
+
+    const size_t row_bytes = image.cols * image.elemSize();
+    for( int r = 0; r < image.rows; ++r )
+    {
+        AddBytes( image.ptr( r ), row_bytes );
+    }
+}
+
+void    ImageDigest::Reset()
+{
+    m_hash = FNV_OFFSET_BASIS;
+}
+
+std::string ImageDigest::Hex() const
+{
+    char text[ 17 ];
+    std::snprintf( text, sizeof( text ), "%016llx", static_cast< unsigned long long >( m_hash ) );
+    return text;
+}
+
+void    ImageDigest::AddBytes( const void* data, size_t length )
+{
+    const unsigned char* bytes = static_cast< const unsigned char* >( data );
+    for( size_t i = 0; i < length; ++i )
+    {
+        m_hash = ( m_hash ^ bytes[ i ] ) * FNV_PRIME;
+    }
+}
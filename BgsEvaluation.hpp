@@ -0,0 +1,118 @@
+/****************************************************************************
+*
+*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+******************************************************************************/
+
+/****************************************************************************
+*
+* BgsEvaluation.hpp
+*
+* Purpose: Accuracy of foreground masks against ground truth masks. Ground
+*          truth uses the labels of the changedetection.net data sets: motion
+*          pixels are positives, static and shadow pixels are negatives, and
+*          pixels outside of the region of interest or of unknown motion are
+*          not scored. Plain binary masks (0 and 255) are valid ground truth.
+*
+*          ImageDigest hashes the exact contents of images over a run, so the
+*          output of an algorithm can be compared against a stored golden
+*          value after optimizations or in different execution modes.
+
+Example:
+    Algorithms::BackgroundSubtraction::ConfusionMatrix confusion;
+    Algorithms::BackgroundSubtraction::ImageDigest digest;
+    for each frame:
+        bgs->apply( frame, fgmask );
+        confusion.Add( fgmask, truth );
+        digest.Add( fgmask );
+
+    double f = confusion.FMeasure();
+    std::string golden = digest.Hex();
+******************************************************************************/
+
+#ifndef _BGS_EVALUATION_H_
+#define _BGS_EVALUATION_H_
+
+#include <cstdint>
+#include <string>
+#include "Image.hpp"
+
+namespace Algorithms
+{
+    namespace BackgroundSubtraction
+    {
+
+        // --- Ground truth labels ---
+        const unsigned char GT_STATIC = 0;
+        const unsigned char GT_SHADOW = 50;
+        const unsigned char GT_OUTSIDE_ROI = 85;
+        const unsigned char GT_UNKNOWN = 170;
+        const unsigned char GT_MOTION = 255;
+
+        // --- Pixel classification counts summed over frames ---
+        class ConfusionMatrix
+        {
+        public:
+            ConfusionMatrix();
+
+            // Score a foreground mask (non-zero is foreground, except for shadows) against its ground truth.
+            void    Add( const BwImage& mask, const BwImage& truth );
+            void    Reset();
+
+            uint64_t    TruePositives() const { return m_tp; }
+            uint64_t    FalsePositives() const { return m_fp; }
+            uint64_t    FalseNegatives() const { return m_fn; }
+            uint64_t    TrueNegatives() const { return m_tn; }
+
+            // Scores are 0 if their denominator is 0.
+            double  Precision() const;
+            double  Recall() const;
+            double  FMeasure() const;
+
+            // Percentage of wrong classifications.
+            double  PWC() const;
+
+        private:
+            uint64_t    m_tp;
+            uint64_t    m_fp;
+            uint64_t    m_fn;
+            uint64_t    m_tn;
+        };
+
+        // --- 64 bit FNV-1a hash of a sequence of images ---
+        class ImageDigest
+        {
+        public:
+            ImageDigest();
+
+            // Hash the type, size and pixel values of an image. Padding of non-continuous
+            // images is skipped.
+            void    Add( const cv::Mat& image );
+            void    Reset();
+
+            uint64_t    Value() const { return m_hash; }
+
+            // Value() as 16 lower case hexadecimal digits.
+            std::string Hex() const;
+
+        private:
+            void    AddBytes( const void* data, size_t length );
+
+            uint64_t    m_hash;
+        };
+
+    };
+};
+
+#endif
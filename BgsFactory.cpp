@@ -0,0 +1,336 @@
+/****************************************************************************
+*
+*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+******************************************************************************/
+
+#include <cmath>
+#include <limits>
+#include <mutex>
+#include <set>
+#include <type_traits>
+#include "BgsFactory.hpp"
+#include "AdaptiveMedianBGS.hpp"
+#include "Eigenbackground.hpp"
+#include "GrimsonGMM.hpp"
+#include "MeanBGS.hpp"
+#include "PratiMediodBGS.hpp"
+#include "WrenGA.hpp"
+#include "ZivkovicAGMM.hpp"
+
+using namespace Algorithms::BackgroundSubtraction;
+
+namespace
+{
+    // Reads values out of a parameter map and reports the ones that were never read.
+    class ParamReader
+    {
+    public:
+        ParamReader( const std::string& name, const BgsParamMap& params ) :
+            m_name( name ),
+            m_params( params )
+        {}
+
+        template< typename T >
+        void    Read( const std::string& key, T& value )
+        {
+            BgsParamMap::const_iterator it = m_params.find( key );
+            if( it != m_params.end() )
+            {
+                // the negated test rejects NaN as well
+                if( !( it->second >= static_cast< double >( std::numeric_limits< T >::lowest() ) &&
+                       it->second <= static_cast< double >( std::numeric_limits< T >::max() ) ) )
+                {
+                    CV_Error( cv::Error::StsOutOfRange, "Parameter '" + key + "' is out of range for " + m_name );
+                }
+
+                // integer and boolean parameters would silently drop the fraction
+                if( std::is_integral< T >::value && std::floor( it->second ) != it->second )
+                {
+                    CV_Error( cv::Error::StsOutOfRange, "Parameter '" + key + "' must be a whole number for " + m_name );
+                }
+
+                value = static_cast< T >( it->second );
+                m_read.insert( key );
+            }
+        }
+
+        // Same for parameters that must be at least minimum (also checked for the default).
+        template< typename T >
+        void    Read( const std::string& key, T& value, T minimum )
+        {
+            Read( key, value );
+            if( value < minimum )
+            {
+                CV_Error( cv::Error::StsOutOfRange, "Parameter '" + key + "' must be at least " +
+                          std::to_string( minimum ) + " for " + m_name );
+            }
+        }
+
+        // HighThreshold defaults to twice LowThreshold, saturated to the range of the thresholds.
+        template< typename T >
+        void    ReadThresholds( T& low_threshold, T& high_threshold )
+        {
+            Read( "LowThreshold", low_threshold );
+            high_threshold = cv::saturate_cast< T >( 2.0 * low_threshold );
+            Read( "HighThreshold", high_threshold );
+        }
+
+        // Channels, and Depth as the number of bits per channel (8, 16 or 32 for float frames).
+        void    ReadFrameType( BgsParams& params )
+        {
+            Read( "Channels", params.Channels() );
+            if( params.Channels() < 1 || params.Channels() > 3 )
+            {
+                CV_Error( cv::Error::StsOutOfRange, "Channels must be 1, 2 or 3 for " + m_name );
+            }
+
+            int bits = 8;
+            Read( "Depth", bits );
+            switch( bits )
+            {
+            case 8:
+                params.Depth() = CV_8U;
+                break;
+            case 16:
+                params.Depth() = CV_16U;
+                break;
+            case 32:
+                params.Depth() = CV_32F;
+                break;
+            default:
+                CV_Error( cv::Error::StsBadArg, "Depth must be 8, 16 or 32 for " + m_name );
+            }
+        }
+
+        void    CheckUnused() const
+        {
+            for( BgsParamMap::const_iterator it = m_params.begin(); it != m_params.end(); ++it )
+            {
+                if( m_read.count( it->first ) == 0 )
+                {
+                    CV_Error( cv::Error::StsBadArg, "Unknown parameter '" + it->first + "' for " + m_name );
+                }
+            }
+        }
+
+    private:
+        std::string             m_name;
+        const BgsParamMap&      m_params;
+        std::set< std::string > m_read;
+    };
+
+    template< typename TBgs >
+    cv::Ptr< Bgs >  Initalized( const BgsParams& params )
+    {
+        cv::Ptr< Bgs > bgs( new TBgs() );
+        bgs->Initalize( params );
+        return bgs;
+    }
+
+    cv::Ptr< Bgs >  CreateAdaptiveMedianBGS( int width, int height, const BgsParamMap& values )
+    {
+        AdaptiveMedianParams params;
+        params.SetFrameSize( width, height );
+
+        ParamReader reader( "AdaptiveMedianBGS", values );
+        reader.ReadFrameType( params );
+        reader.ReadThresholds( params.LowThreshold(), params.HighThreshold() );
+        reader.Read( "SamplingRate", params.SamplingRate() );
+        reader.Read( "LearningFrames", params.LearningFrames() );
+        reader.CheckUnused();
+
+        return Initalized< AdaptiveMedianBGS >( params );
+    }
+
+    cv::Ptr< Bgs >  CreateEigenbackground( int width, int height, const BgsParamMap& values )
+    {
+        EigenbackgroundParams params;
+        params.SetFrameSize( width, height );
+        params.LowThreshold() = 15 * 15;
+        params.HistorySize() = 100;
+        params.EmbeddedDim() = 20;
+
+        ParamReader reader( "Eigenbackground", values );
+        reader.ReadFrameType( params );
+        reader.ReadThresholds( params.LowThreshold(), params.HighThreshold() );
+        reader.Read( "HistorySize", params.HistorySize() );
+        reader.Read( "EmbeddedDim", params.EmbeddedDim() );
+        reader.CheckUnused();
+
+        return Initalized< Eigenbackground >( params );
+    }
+
+    cv::Ptr< Bgs >  CreateGrimsonGMM( int width, int height, const BgsParamMap& values )
+    {
+        GrimsonParams params;
+        params.SetFrameSize( width, height );
+        params.LowThreshold() = 3.0f * 3.0f;
+        params.Alpha() = 0.001f;
+        params.MaxModes() = 3;
+
+        ParamReader reader( "GrimsonGMM", values );
+        reader.ReadFrameType( params );
+        reader.ReadThresholds( params.LowThreshold(), params.HighThreshold() );
+        reader.Read( "Alpha", params.Alpha() );
+        reader.Read( "MaxModes", params.MaxModes(), 1 );
+        reader.Read( "TileSize", params.TileSize() );
+        reader.Read( "TileThreshold", params.TileThreshold() );
+        reader.Read( "TileDecay", params.TileDecay() );
+        reader.Read( "ShadowDetection", params.ShadowDetection() );
+        reader.Read( "ShadowRatio", params.ShadowRatio() );
+        reader.Read( "LazyDecay", params.LazyDecay() );
+        reader.CheckUnused();
+
+        return Initalized< GrimsonGMM >( params );
+    }
+
+    cv::Ptr< Bgs >  CreateMeanBGS( int width, int height, const BgsParamMap& values )
+    {
+        MeanParams params;
+        params.SetFrameSize( width, height );
+        params.LowThreshold() = 3 * 30 * 30;
+        params.Alpha() = 1e-6f;
+        params.LearningFrames() = 30;
+
+        ParamReader reader( "MeanBGS", values );
+        reader.ReadFrameType( params );
+        reader.ReadThresholds( params.LowThreshold(), params.HighThreshold() );
+        reader.Read( "Alpha", params.Alpha() );
+        reader.Read( "LearningFrames", params.LearningFrames() );
+        reader.CheckUnused();
+
+        return Initalized< MeanBGS >( params );
+    }
+
+    cv::Ptr< Bgs >  CreatePratiMediodBGS( int width, int height, const BgsParamMap& values )
+    {
+        PratiParams params;
+        params.SetFrameSize( width, height );
+        params.LowThreshold() = 30;
+        params.SamplingRate() = 5;
+        params.HistorySize() = 16;
+        params.Weight() = 5;
+
+        ParamReader reader( "PratiMediodBGS", values );
+        reader.ReadFrameType( params );
+        reader.ReadThresholds( params.LowThreshold(), params.HighThreshold() );
+        reader.Read( "SamplingRate", params.SamplingRate() );
+        reader.Read( "HistorySize", params.HistorySize() );
+        reader.Read( "Weight", params.Weight() );
+        reader.CheckUnused();
+
+        return Initalized< PratiMediodBGS >( params );
+    }
+
+    cv::Ptr< Bgs >  CreateWrenGA( int width, int height, const BgsParamMap& values )
+    {
+        WrenParams params;
+        params.SetFrameSize( width, height );
+        params.LowThreshold() = 3.5f * 3.5f;
+        params.Alpha() = 0.005f;
+        params.LearningFrames() = 30;
+
+        ParamReader reader( "WrenGA", values );
+        reader.ReadFrameType( params );
+        reader.ReadThresholds( params.LowThreshold(), params.HighThreshold() );
+        reader.Read( "Alpha", params.Alpha() );
+        reader.Read( "LearningFrames", params.LearningFrames() );
+        reader.CheckUnused();
+
+        return Initalized< WrenGA >( params );
+    }
+
+    cv::Ptr< Bgs >  CreateZivkovicAGMM( int width, int height, const BgsParamMap& values )
+    {
+        ZivkovicParams params;
+        params.SetFrameSize( width, height );
+        params.LowThreshold() = 5.0f * 5.0f;
+        params.Alpha() = 0.001f;
+        params.MaxModes() = 3;
+
+        ParamReader reader( "ZivkovicAGMM", values );
+        reader.ReadFrameType( params );
+        reader.ReadThresholds( params.LowThreshold(), params.HighThreshold() );
+        reader.Read( "Alpha", params.Alpha() );
+        reader.Read( "MaxModes", params.MaxModes(), 1 );
+        reader.Read( "ShadowDetection", params.ShadowDetection() );
+        reader.Read( "ShadowRatio", params.ShadowRatio() );
+        reader.Read( "LazyDecay", params.LazyDecay() );
+        reader.CheckUnused();
+
+        return Initalized< ZivkovicAGMM >( params );
+    }
+
+    typedef std::map< std::string, BgsCreator > BgsRegistry;
+
+    std::mutex  g_registry_mutex;
+
+    BgsRegistry&    Registry()
+    {
+        static BgsRegistry registry = {
+            { "AdaptiveMedianBGS", CreateAdaptiveMedianBGS },
+            { "Eigenbackground", CreateEigenbackground },
+            { "GrimsonGMM", CreateGrimsonGMM },
+            { "MeanBGS", CreateMeanBGS },
+            { "PratiMediodBGS", CreatePratiMediodBGS },
+            { "WrenGA", CreateWrenGA },
+            { "ZivkovicAGMM", CreateZivkovicAGMM },
+        };
+        return registry;
+    }
+}
+
+cv::Ptr< Bgs >  Algorithms::BackgroundSubtraction::createBgs( const std::string& name, int width, int height,
+                                                              const BgsParamMap& params )
+{
+    CV_Assert( width > 0 && height > 0 );
+
+    BgsCreator creator = NULL;
+    {
+        std::lock_guard< std::mutex > lock( g_registry_mutex );
+        BgsRegistry::const_iterator it = Registry().find( name );
+        if( it != Registry().end() )
+        {
+            creator = it->second;
+        }
+    }
+
+    if( creator == NULL )
+    {
+        CV_Error( cv::Error::StsBadArg, "Unknown background subtraction algorithm '" + name + "'" );
+    }
+
+    return creator( width, height, params );
+}
+
+void    Algorithms::BackgroundSubtraction::registerBgs( const std::string& name, BgsCreator creator )
+{
+    CV_Assert( creator != NULL );
+
+    std::lock_guard< std::mutex > lock( g_registry_mutex );
+    Registry()[ name ] = creator;
+}
+
+std::vector< std::string >  Algorithms::BackgroundSubtraction::getBgsNames()
+{
+    std::lock_guard< std::mutex > lock( g_registry_mutex );
+
+    std::vector< std::string > names;
+    for( BgsRegistry::const_iterator it = Registry().begin(); it != Registry().end(); ++it )
+    {
+        names.push_back( it->first );
+    }
+    return names;
+}
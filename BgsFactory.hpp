@@ -0,0 +1,79 @@
+/****************************************************************************
+*
+*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+******************************************************************************/
+
+/****************************************************************************
+*
+* BgsFactory.hpp
+*
+* Purpose: String keyed registry of the BGS algorithms. An algorithm is
+*          created from its name and a map of parameter values, and is
+*          returned initialized (all model memory allocated) for the given
+*          frame size. Parameters are named after the accessors of the
+*          algorithm's parameter class; missing parameters keep their
+*          defaults, and unknown ones or values the parameter cannot hold
+*          (including fractions for whole number and boolean parameters)
+*          are an error. If only LowThreshold is given, HighThreshold defaults
+*          to twice its value, saturated to the largest threshold. Channels
+*          (1 to 3, default 3) and Depth (8, 16 or 32 bits per channel,
+*          default 8) select the frame type the model is built for. Mixture
+*          models need a MaxModes of at least 1.
+
+Example:
+    Algorithms::BackgroundSubtraction::BgsParamMap params;
+    params[ "LowThreshold" ] = 3.0 * 3.0;
+    params[ "Alpha" ] = 0.001;
+
+    auto bgs = Algorithms::BackgroundSubtraction::createBgs( "GrimsonGMM", width, height, params );
+
+    cv::Mat data;
+    cv::Mat fgmask;
+    bgs->apply( data, fgmask );
+******************************************************************************/
+
+#ifndef _BGS_FACTORY_H_
+#define _BGS_FACTORY_H_
+
+#include <map>
+#include <string>
+#include <vector>
+#include "Bgs.hpp"
+
+namespace Algorithms
+{
+    namespace BackgroundSubtraction
+    {
+
+        typedef std::map< std::string, double > BgsParamMap;
+
+        // Creates an algorithm initialized for frames of width x height.
+        typedef cv::Ptr< Bgs > ( *BgsCreator )( int width, int height, const BgsParamMap& params );
+
+        // Create the algorithm registered under name. Throws cv::Exception for unknown
+        // algorithms and parameters.
+        cv::Ptr< Bgs >  createBgs( const std::string& name, int width, int height,
+                                   const BgsParamMap& params = BgsParamMap() );
+
+        // Register an additional algorithm, replacing any algorithm of the same name.
+        void    registerBgs( const std::string& name, BgsCreator creator );
+
+        // Names of all registered algorithms in alphabetical order.
+        std::vector< std::string >  getBgsNames();
+
+    };
+};
+
+#endif
@@ -29,6 +29,8 @@
 #ifndef BGS_PARAMS_H_
 #define BGS_PARAMS_H_
 
+#include "RegionOfInterest.hpp"
+
 namespace Algorithms
 {
 namespace BackgroundSubtraction
@@ -37,6 +39,7 @@ namespace BackgroundSubtraction
 class BgsParams
 {
 public:
+	BgsParams() : m_width(0), m_height(0), m_size(0), m_channels(3), m_depth(CV_8U) {}
 	virtual ~BgsParams() {}
 
 	virtual void SetFrameSize(unsigned int width, unsigned int height)
@@ -50,10 +53,34 @@ public:
 	unsigned int &Height() { return m_height; }
 	unsigned int &Size() { return m_size; }
 
+	unsigned int Width() const { return m_width; }
+	unsigned int Height() const { return m_height; }
+	unsigned int Size() const { return m_size; }
+
+	// Number of channels of the frames (1, 2 or 3). The model is allocated for this number of channels.
+	int &Channels() { return m_channels; }
+	int Channels() const { return m_channels; }
+
+	// Depth of the frames (CV_8U, CV_16U or CV_32F). Thresholds are in units of the frame values.
+	int &Depth() { return m_depth; }
+	int Depth() const { return m_depth; }
+
+	// OpenCV type of the frames.
+	int Type() const { return CV_MAKETYPE(m_depth, m_channels); }
+
+	// Part of the frame that is processed. The whole frame is processed by default. Algorithms
+	// only allocate model storage for the active pixels and set all other pixels to background.
+	RegionOfInterest &Roi() { return m_roi; }
+	const RegionOfInterest &Roi() const { return m_roi; }
+
 protected:
 	unsigned int m_width;
 	unsigned int m_height;
 	unsigned int m_size;
+	int m_channels;
+	int m_depth;
+
+	RegionOfInterest m_roi;
 };
 
 };
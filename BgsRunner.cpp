@@ -0,0 +1,184 @@
+/****************************************************************************
+*
+*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+******************************************************************************/
+
+#include "BgsRunner.hpp"
+#include "Topology.hpp"
+
+using namespace Algorithms::BackgroundSubtraction;
+
+BgsRunner::BgsRunner( bool pin ) :
+    m_pin( pin )
+{
+    if( m_pin )
+    {
+        m_cpus = InterleavedCpus();
+    }
+}
+
+BgsRunner::~BgsRunner()
+{
+    for( std::unique_ptr< Worker >& worker : m_workers )
+    {
+        {
+            std::lock_guard< std::mutex > lock( worker->mutex );
+            worker->stop = true;
+        }
+        worker->changed.notify_all();
+        worker->thread.join();
+    }
+}
+
+int     BgsRunner::AddStream( const std::string& algorithm, int width, int height, const BgsParamMap& params )
+{
+    int stream = Streams();
+
+    std::unique_ptr< Worker > worker( new Worker() );
+    worker->placement.stream = stream;
+    worker->placement.cpu = m_pin ? m_cpus[ stream % m_cpus.size() ] : -1;
+    worker->placement.pinned = false;
+    worker->placement.node = 0;
+    worker->stop = false;
+    worker->thread = std::thread( WorkerLoop, worker.get() );
+
+    // pin first, so the model memory is first touched on the node of the worker
+    Worker& w = *worker;
+    m_workers.push_back( std::move( worker ) );
+    Post( w, [ &w, &algorithm, width, height, &params ]() {
+        if( w.placement.cpu >= 0 )
+        {
+            w.placement.pinned = PinCurrentThread( w.placement.cpu );
+        }
+        w.placement.node = CurrentNumaNode();
+
+        // the loops stay on the pinned worker instead of OpenCV's unpinned thread pool
+        w.bgs = createBgs( algorithm, width, height, params );
+        w.bgs->SetSerial( true );
+    } );
+
+    try
+    {
+        Wait( w );
+    }
+    catch( ... )
+    {
+        // the stream is not added
+        {
+            std::lock_guard< std::mutex > lock( w.mutex );
+            w.stop = true;
+        }
+        w.changed.notify_all();
+        w.thread.join();
+        m_workers.pop_back();
+        throw;
+    }
+
+    return stream;
+}
+
+void    BgsRunner::Process( const std::vector< cv::Mat >& frames, std::vector< BwImage >& masks )
+{
+    CV_Assert( static_cast< int >( frames.size() ) == Streams() );
+    masks.resize( frames.size() );
+
+    for( int i = 0; i < Streams(); ++i )
+    {
+        Worker& worker = *m_workers[ i ];
+        const cv::Mat& frame = frames[ i ];
+        BwImage& mask = masks[ i ];
+        Post( worker, [ &worker, &frame, &mask ]() { worker.bgs->apply( frame, mask ); } );
+    }
+
+    std::exception_ptr error;
+    for( int i = 0; i < Streams(); ++i )
+    {
+        try
+        {
+            Wait( *m_workers[ i ] );
+        }
+        catch( ... )
+        {
+            if( !error )
+                error = std::current_exception();
+        }
+    }
+
+    if( error )
+    {
+        std::rethrow_exception( error );
+    }
+}
+
+std::vector< StreamPlacement >  BgsRunner::Placement() const
+{
+    std::vector< StreamPlacement > placement;
+    for( const std::unique_ptr< Worker >& worker : m_workers )
+    {
+        placement.push_back( worker->placement );
+    }
+    return placement;
+}
+
+void    BgsRunner::WorkerLoop( Worker* worker )
+{
+    std::unique_lock< std::mutex > lock( worker->mutex );
+    for( ;; )
+    {
+        worker->changed.wait( lock, [ worker ]() { return worker->stop || worker->task; } );
+        if( !worker->task )
+        {
+            return;
+        }
+
+        lock.unlock();
+        std::exception_ptr error;
+        try
+        {
+            worker->task();
+        }
+        catch( ... )
+        {
+            error = std::current_exception();
+        }
+        lock.lock();
+
+        worker->error = error;
+        worker->task = std::function< void() >();
+        worker->changed.notify_all();
+    }
+}
+
+void    BgsRunner::Post( Worker& worker, const std::function< void() >& task )
+{
+    {
+        std::lock_guard< std::mutex > lock( worker.mutex );
+        worker.task = task;
+    }
+    worker.changed.notify_all();
+}
+
+void    BgsRunner::Wait( Worker& worker )
+{
+    std::unique_lock< std::mutex > lock( worker.mutex );
+    worker.changed.wait( lock, [ &worker ]() { return !worker.task; } );
+
+    if( worker.error )
+    {
+        std::exception_ptr error = worker.error;
+        worker.error = std::exception_ptr();
+        std::rethrow_exception( error );
+    }
+}
@@ -0,0 +1,129 @@
+/****************************************************************************
+*
+*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+******************************************************************************/
+
+/****************************************************************************
+*
+* BgsRunner.hpp
+*
+* Purpose: Processes several video streams in parallel with one worker
+*          thread per stream. Each worker is pinned to its own processor,
+*          spread over the NUMA nodes, and creates and initializes the model
+*          of its stream itself, so the model memory is first touched by,
+*          and therefore placed on the node of, the processor that uses it.
+*          The algorithms run serially (Bgs::SetSerial()), so their loops stay
+*          on the pinned worker instead of OpenCV's thread pool, whose threads
+*          are not pinned; the streams provide the parallelism. OpenCV
+*          functions inside the algorithms still use the pool, which
+*          cv::setNumThreads( 1 ) disables for the whole process.
+*          Placement() reports where each stream landed.
+
+Example:
+    Algorithms::BackgroundSubtraction::BgsRunner runner;
+    runner.AddStream( "ZivkovicAGMM", 1920, 1080 );
+    runner.AddStream( "ZivkovicAGMM", 1280, 720 );
+
+    std::vector< cv::Mat > frames( 2 );
+    std::vector< BwImage > masks;
+    for each set of frames:
+        runner.Process( frames, masks );
+
+    for( const Algorithms::BackgroundSubtraction::StreamPlacement& placement : runner.Placement() )
+        std::cout << placement.stream << ": cpu " << placement.cpu << ", node " << placement.node << std::endl;
+******************************************************************************/
+
+#ifndef _BGS_RUNNER_H_
+#define _BGS_RUNNER_H_
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "BgsFactory.hpp"
+
+namespace Algorithms
+{
+    namespace BackgroundSubtraction
+    {
+
+        // --- Processor and NUMA node a stream is processed on ---
+        struct StreamPlacement
+        {
+            int     stream;
+            int     cpu;        // processor the worker is pinned to (-1 if not pinned)
+            bool    pinned;     // false if the platform refused the pinning
+            int     node;       // NUMA node of the processor, which holds the model
+        };
+
+        // --- Parallel processing of streams on pinned workers ---
+        class BgsRunner
+        {
+        public:
+            // pin - pin workers to processors (otherwise the operating system places them)
+            explicit BgsRunner( bool pin = true );
+            ~BgsRunner();
+
+            // Start a worker and create the algorithm of the stream on it (see createBgs()).
+            // Returns the index of the stream.
+            int     AddStream( const std::string& algorithm, int width, int height,
+                               const BgsParamMap& params = BgsParamMap() );
+
+            int     Streams() const { return static_cast< int >( m_workers.size() ); }
+
+            // Algorithm of a stream. Must not be used while Process() runs.
+            cv::Ptr< Bgs >  Stream( int stream ) const { return m_workers[ stream ]->bgs; }
+
+            // Apply frame i to stream i on its worker, for all streams in parallel, and return
+            // when all streams are done. Exceptions of the workers are rethrown.
+            void    Process( const std::vector< cv::Mat >& frames, std::vector< BwImage >& masks );
+
+            std::vector< StreamPlacement >  Placement() const;
+
+        private:
+            struct Worker
+            {
+                StreamPlacement         placement;
+                cv::Ptr< Bgs >          bgs;
+
+                std::thread             thread;
+                std::mutex              mutex;
+                std::condition_variable changed;
+                std::function< void() > task;       // task to run next, empty if idle
+                bool                    stop;
+                std::exception_ptr      error;      // exception of the last task
+            };
+
+            BgsRunner( const BgsRunner& );
+            BgsRunner&  operator=( const BgsRunner& );
+
+            static void     WorkerLoop( Worker* worker );
+
+            // Post a task to a worker, and wait for it to finish.
+            static void     Post( Worker& worker, const std::function< void() >& task );
+            static void     Wait( Worker& worker );
+
+            bool    m_pin;
+            std::vector< int >  m_cpus;
+            std::vector< std::unique_ptr< Worker > >    m_workers;
+        };
+
+    };
+};
+
+#endif
@@ -0,0 +1,120 @@
+/****************************************************************************
+*
+*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+******************************************************************************/
+
+#include <algorithm>
+#include <cmath>
+#include "BgsStats.hpp"
+
+using namespace Algorithms::BackgroundSubtraction;
+
+LatencyHistogram::LatencyHistogram()
+{
+    Reset();
+}
+
+void    LatencyHistogram::Add( double seconds )
+{
+    double us = seconds * 1e6;
+
+    int bucket = 0;
+    if( us >= 1 )
+    {
+        // us = m * 2^exponent with m in [0.5, 1)
+        int exponent;
+        std::frexp( us, &exponent );
+        bucket = std::min( exponent, BUCKETS - 1 );
+    }
+
+    m_buckets[ bucket ]++;
+    m_min = m_count == 0 ? seconds : std::min( m_min, seconds );
+    m_max = std::max( m_max, seconds );
+    m_total += seconds;
+    m_count++;
+}
+
+void    LatencyHistogram::Reset()
+{
+    std::fill( m_buckets, m_buckets + BUCKETS, 0 );
+    m_count = 0;
+    m_total = 0;
+    m_min = 0;
+    m_max = 0;
+}
+
+double  LatencyHistogram::Quantile( double q ) const
+{
+    uint64_t rank = static_cast< uint64_t >( std::ceil( q * m_count ) );
+
+    uint64_t count = 0;
+    for( int i = 0; i < BUCKETS; ++i )
+    {
+        count += m_buckets[ i ];
+        if( count >= rank && count > 0 )
+        {
+            return std::min( BucketUpperBound( i ), m_max );
+        }
+    }
+
+    return m_max;
+}
+
+double  LatencyHistogram::BucketUpperBound( int i )
+{
+    return std::ldexp( 1.0, i ) * 1e-6;
+}
+
+GmmModeCounts&  GmmModeCounts::operator+=( const GmmModeCounts& counts )
+{
+    matched += counts.matched;
+    added += counts.added;
+    replaced += counts.replaced;
+    pruned += counts.pruned;
+    return *this;
+}
+
+void    BgsStats::Reset()
+{
+    frame.Reset();
+    subtract.Reset();
+    update.Reset();
+    post_process.Reset();
+    modes = GmmModeCounts();
+}
+
+void    BgsStatsRecorder::AddLatency( LatencyHistogram BgsStats::*stage, double seconds )
+{
+    std::lock_guard< std::mutex > lock( m_mutex );
+    ( m_stats.*stage ).Add( seconds );
+}
+
+void    BgsStatsRecorder::AddModes( const GmmModeCounts& counts )
+{
+    std::lock_guard< std::mutex > lock( m_mutex );
+    m_stats.modes += counts;
+}
+
+BgsStats    BgsStatsRecorder::Snapshot() const
+{
+    std::lock_guard< std::mutex > lock( m_mutex );
+    return m_stats;
+}
+
+void    BgsStatsRecorder::Reset()
+{
+    std::lock_guard< std::mutex > lock( m_mutex );
+    m_stats.Reset();
+}
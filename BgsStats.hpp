@@ -0,0 +1,154 @@
+/****************************************************************************
+*
+*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+******************************************************************************/
+
+/****************************************************************************
+*
+* BgsStats.hpp
+*
+* Purpose: Run time statistics of the BGS algorithms: latency histograms of
+*          the processing stages of each frame and counters of the mode
+*          changes of the Gaussian mixture models. Statistics are only
+*          collected by algorithms they were enabled for.
+
+Example:
+    bgs->EnableStats( true );
+    ...
+    Algorithms::BackgroundSubtraction::BgsStats stats = bgs->GetStats();
+    double p99 = stats.frame.Quantile( 0.99 );
+******************************************************************************/
+
+#ifndef _BGS_STATS_H_
+#define _BGS_STATS_H_
+
+#include <cstdint>
+#include <mutex>
+#include <opencv2/core.hpp>
+
+namespace Algorithms
+{
+    namespace BackgroundSubtraction
+    {
+
+        // --- Histogram of latencies with power of two buckets ---
+        class LatencyHistogram
+        {
+        public:
+            // Bucket 0 holds latencies below 1 us, bucket i > 0 latencies in [2^(i-1), 2^i) us.
+            // The last bucket also holds all longer latencies.
+            static const int BUCKETS = 24;
+
+            LatencyHistogram();
+
+            void    Add( double seconds );
+            void    Reset();
+
+            uint64_t    Count() const { return m_count; }
+            uint64_t    Bucket( int i ) const { return m_buckets[ i ]; }
+
+            // Latencies in seconds. All are 0 for an empty histogram.
+            double  Total() const { return m_total; }
+            double  Min() const { return m_min; }
+            double  Max() const { return m_max; }
+            double  Mean() const { return m_count == 0 ? 0 : m_total / m_count; }
+
+            // Upper bound of the bucket holding the quantile q (0 to 1) of the latencies, limited
+            // to the maximum latency.
+            double  Quantile( double q ) const;
+
+            // Upper bound of bucket i in seconds.
+            static double   BucketUpperBound( int i );
+
+        private:
+            uint64_t    m_buckets[ BUCKETS ];
+            uint64_t    m_count;
+            double      m_total;
+            double      m_min;
+            double      m_max;
+        };
+
+        // --- Mode changes of the Gaussian mixture models, summed over all pixels ---
+        struct GmmModeCounts
+        {
+            GmmModeCounts() : matched( 0 ), added( 0 ), replaced( 0 ), pruned( 0 ) {}
+
+            GmmModeCounts&  operator+=( const GmmModeCounts& counts );
+
+            uint64_t    matched;    // pixels matching a mode
+            uint64_t    added;      // modes created for unmatched pixels
+            uint64_t    replaced;   // weakest modes replaced by unmatched pixels of full mixtures
+            uint64_t    pruned;     // modes removed for their weight
+        };
+
+        // --- Statistics of an algorithm ---
+        struct BgsStats
+        {
+            void    Reset();
+
+            LatencyHistogram    frame;          // complete apply() call, counts the frames
+            LatencyHistogram    subtract;
+            LatencyHistogram    update;
+            LatencyHistogram    post_process;   // mask post-processing of algorithms that have one
+
+            GmmModeCounts       modes;
+        };
+
+        // --- Thread safe collection of statistics ---
+        class BgsStatsRecorder
+        {
+        public:
+            void        AddLatency( LatencyHistogram BgsStats::*stage, double seconds );
+            void        AddModes( const GmmModeCounts& counts );
+
+            BgsStats    Snapshot() const;
+            void        Reset();
+
+        private:
+            mutable std::mutex  m_mutex;
+            BgsStats            m_stats;
+        };
+
+        // --- Records the lifetime of the timer into a stage, does nothing without a recorder ---
+        class StageTimer
+        {
+        public:
+            StageTimer( BgsStatsRecorder* recorder, LatencyHistogram BgsStats::*stage ) :
+                m_recorder( recorder ),
+                m_stage( stage ),
+                m_start( recorder != NULL ? cv::getTickCount() : 0 )
+            {}
+
+            ~StageTimer()
+            {
+                if( m_recorder != NULL )
+                {
+                    m_recorder->AddLatency( m_stage, ( cv::getTickCount() - m_start ) / cv::getTickFrequency() );
+                }
+            }
+
+        private:
+            StageTimer( const StageTimer& );
+            StageTimer& operator=( const StageTimer& );
+
+            BgsStatsRecorder*               m_recorder;
+            LatencyHistogram BgsStats::*    m_stage;
+            int64                           m_start;
+        };
+
+    };
+};
+
+#endif
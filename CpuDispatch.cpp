@@ -0,0 +1,147 @@
+/****************************************************************************
+*
+*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+******************************************************************************/
+
+#include <atomic>
+#include <opencv2/core.hpp>
+#include "CpuDispatch.hpp"
+
+using namespace Algorithms::BackgroundSubtraction;
+
+namespace
+{
+    const CpuPath   ALL_PATHS[] = { CPU_PATH_BASELINE, CPU_PATH_SSE4_2, CPU_PATH_AVX2, CPU_PATH_AVX512 };
+
+    // Paths the kernels were compiled for (BGS_DISPATCH_* are set by the build).
+    bool    CpuPathBuilt( CpuPath path )
+    {
+        switch( path )
+        {
+        case CPU_PATH_BASELINE:
+            return true;
+#ifdef BGS_DISPATCH_SSE4_2
+        case CPU_PATH_SSE4_2:
+            return true;
+#endif
+#ifdef BGS_DISPATCH_AVX2
+        case CPU_PATH_AVX2:
+            return true;
+#endif
+#ifdef BGS_DISPATCH_AVX512
+        case CPU_PATH_AVX512:
+            return true;
+#endif
+        default:
+            return false;
+        }
+    }
+
+    // cv::checkHardwareSupport() also checks that the operating system saves the wide registers.
+    bool    CpuPathHardware( CpuPath path )
+    {
+        switch( path )
+        {
+        case CPU_PATH_SSE4_2:
+            return cv::checkHardwareSupport( CV_CPU_SSE4_2 );
+        case CPU_PATH_AVX2:
+            return cv::checkHardwareSupport( CV_CPU_AVX2 );
+        case CPU_PATH_AVX512:
+            return cv::checkHardwareSupport( CV_CPU_AVX_512F ) && cv::checkHardwareSupport( CV_CPU_AVX_512CD ) &&
+                   cv::checkHardwareSupport( CV_CPU_AVX_512BW ) && cv::checkHardwareSupport( CV_CPU_AVX_512DQ ) &&
+                   cv::checkHardwareSupport( CV_CPU_AVX_512VL );
+        default:
+            return true;
+        }
+    }
+
+    std::atomic< int >&     ActivePath()
+    {
+        static std::atomic< int > path( DetectedCpuPath() );
+        return path;
+    }
+}
+
+bool    Algorithms::BackgroundSubtraction::CpuPathSupported( CpuPath path )
+{
+    return CpuPathBuilt( path ) && CpuPathHardware( path );
+}
+
+CpuPath Algorithms::BackgroundSubtraction::DetectedCpuPath()
+{
+    static const CpuPath detected = [] {
+        CpuPath best = CPU_PATH_BASELINE;
+        for( CpuPath path : ALL_PATHS )
+        {
+            if( CpuPathSupported( path ) )
+            {
+                best = path;
+            }
+        }
+        return best;
+    }();
+
+    return detected;
+}
+
+CpuPath Algorithms::BackgroundSubtraction::ActiveCpuPath()
+{
+    return static_cast< CpuPath >( ActivePath().load( std::memory_order_relaxed ) );
+}
+
+void    Algorithms::BackgroundSubtraction::ForceCpuPath( CpuPath path )
+{
+    if( !CpuPathSupported( path ) )
+    {
+        CV_Error( cv::Error::StsNotImplemented, std::string( "The " ) + CpuPathName( path ) +
+                  " path was not built or is not supported by the processor" );
+    }
+
+    ActivePath().store( path );
+}
+
+void    Algorithms::BackgroundSubtraction::ResetCpuPath()
+{
+    ActivePath().store( DetectedCpuPath() );
+}
+
+const char*     Algorithms::BackgroundSubtraction::CpuPathName( CpuPath path )
+{
+    switch( path )
+    {
+    case CPU_PATH_SSE4_2:
+        return "sse4.2";
+    case CPU_PATH_AVX2:
+        return "avx2";
+    case CPU_PATH_AVX512:
+        return "avx512";
+    default:
+        return "baseline";
+    }
+}
+
+bool    Algorithms::BackgroundSubtraction::CpuPathFromName( const std::string& name, CpuPath& path )
+{
+    for( CpuPath candidate : ALL_PATHS )
+    {
+        if( name == CpuPathName( candidate ) )
+        {
+            path = candidate;
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,78 @@
+/****************************************************************************
+*
+*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+******************************************************************************/
+
+/****************************************************************************
+*
+* CpuDispatch.hpp
+*
+* Purpose: Selection of the instruction set used by the hot kernels. Kernels
+*          are compiled once per instruction set into the same library (see
+*          the *.simd.hpp files and CMakeLists.txt) and the best path that
+*          was built and is supported by the processor is chosen once, on
+*          first use. The path can be forced for benchmarking.
+
+Example:
+    std::cout << Algorithms::BackgroundSubtraction::CpuPathName(
+                     Algorithms::BackgroundSubtraction::ActiveCpuPath() ) << std::endl;
+
+    Algorithms::BackgroundSubtraction::ForceCpuPath( Algorithms::BackgroundSubtraction::CPU_PATH_SSE4_2 );
+    ... benchmark ...
+    Algorithms::BackgroundSubtraction::ResetCpuPath();
+******************************************************************************/
+
+#ifndef _CPU_DISPATCH_H_
+#define _CPU_DISPATCH_H_
+
+#include <string>
+
+namespace Algorithms
+{
+    namespace BackgroundSubtraction
+    {
+
+        // --- Instruction sets kernels are compiled for, in ascending order ---
+        enum CpuPath
+        {
+            CPU_PATH_BASELINE,      // flags of the build (SSE2 on x86-64)
+            CPU_PATH_SSE4_2,
+            CPU_PATH_AVX2,          // with FMA3 and F16C
+            CPU_PATH_AVX512         // AVX-512 F, CD, BW, DQ and VL (Skylake-SP)
+        };
+
+        // True if the kernels of the path were built and the processor supports the path.
+        bool    CpuPathSupported( CpuPath path );
+
+        // Best supported path, detected once.
+        CpuPath DetectedCpuPath();
+
+        // Path used by the kernels: the detected one unless another one is forced. May be called
+        // from any thread.
+        CpuPath ActiveCpuPath();
+
+        // Use a supported path instead of the detected one (cv::Error::StsNotImplemented otherwise),
+        // or return to the detected path.
+        void    ForceCpuPath( CpuPath path );
+        void    ResetCpuPath();
+
+        // "baseline", "sse4.2", "avx2" or "avx512", and back. Returns false for unknown names.
+        const char*     CpuPathName( CpuPath path );
+        bool            CpuPathFromName( const std::string& name, CpuPath& path );
+
+    };
+};
+
+#endif
@@ -41,144 +41,145 @@ Eigenbackground::~Eigenbackground()
 
 void Eigenbackground::Initalize(const BgsParams& param)
 {
-	m_params = (EigenbackgroundParams&)param;
+	m_params = dynamic_cast<const EigenbackgroundParams&>(param);
+
+	// only pixels inside the region of interest are modelled
+	m_spans = m_params.Roi().Spans(m_params.Width(), m_params.Height());
 	
-	//m_background = cvCreateImage(cvSize(m_params.Width(), m_params.Height()), IPL_DEPTH_8U, 3);
-	//m_background.Clear();
-    m_background.create( m_params.Width(), m_params.Height() );
-    m_background.setTo( RgbPixel( BACKGROUND, BACKGROUND, BACKGROUND ) );
+	m_background.create(m_params.Height(), m_params.Width(), m_params.Type());
+	m_background.setTo(cv::Scalar::all(BACKGROUND));
 }
 
-void Eigenbackground::InitModel(const RgbImage& data)
+void Eigenbackground::InitModel(const BaseImage& data)
 {
-    m_pcaData.release();
-    m_pcaAvg.release();
-    m_eigenValues.release();
-    m_eigenVectors.release();
+	m_pca = cv::PCA();
 
-	m_pcaData.create(m_params.HistorySize(), m_params.Size()*3, CV_8UC1);
+	m_pcaData = m_pcaData_arena.Create("Eigenbackground.pcaData", m_params.HistorySize(), SpanPixels(m_spans)*m_params.Channels(), CV_MAKETYPE(m_params.Depth(), 1));
 
-	//m_background.Clear();
-    m_background.setTo( RgbPixel( BACKGROUND, BACKGROUND, BACKGROUND ) );
+	m_background.setTo(cv::Scalar::all(BACKGROUND));
 }
 
-void Eigenbackground::Update(int frame_num, const RgbImage& data,  const BwImage& update_mask)
+void Eigenbackground::Update(int frame_num, const BaseImage& data,  const BwImage& update_mask)
 {
 	// the eigenbackground model is not updated (serious limitation!)
 }
 
-void Eigenbackground::Subtract(int frame_num, const RgbImage& data,  
+void Eigenbackground::Subtract(int frame_num, const BaseImage& data,  
 																BwImage& low_threshold_mask, BwImage& high_threshold_mask)
 {
+	CV_Assert(data.type() == m_params.Type());
+
 	// create eigenbackground
 	if(frame_num == m_params.HistorySize())
 	{
 		// create the eigenspace
-		m_pcaAvg.create( 1, m_pcaData.cols, CV_32F );
-		m_eigenValues.create( m_pcaData.rows, 1, CV_32F );
-		m_eigenVectors.create( m_pcaData.rows, m_pcaData.cols, CV_32F );
-		cvCalcPCA(m_pcaData.data, m_pcaAvg.data, m_eigenValues.data, m_eigenVectors.data, CV_PCA_DATA_AS_ROW);
+		m_pca(m_pcaData, cv::noArray(), cv::PCA::DATA_AS_ROW, m_params.EmbeddedDim());
 
-		int index = 0;
-		for(unsigned int r = 0; r < m_params.Height(); ++r)
-		{
-			for(unsigned int c = 0; c < m_params.Width(); ++c)
-			{
-				for(int ch = 0; ch < m_background.channels(); ++ch)
-				{
-					m_background.at< RgbPixel >(r,c)[0] = (unsigned char)(cvmGet((CvMat*)&m_pcaAvg,0,index)+0.5); // FIXME ch ???
-					index++;
-				}
-			}
-		}
+		cv::Mat mean;
+		m_pca.mean.convertTo(mean, m_params.Depth());
+		ScatterPixels(mean.reshape(m_params.Channels(), 1), m_spans, m_background.size(), m_background);
+	}
+
+	// pixels outside of the region of interest are background (masks passed to a call
+	// restricted by a process mask already hold the previous, cleared, values)
+	if(!m_params.Roi().Empty() && m_process_mask.empty())
+	{
+		low_threshold_mask.setTo(BACKGROUND);
+		high_threshold_mask.setTo(BACKGROUND);
 	}
 
 	if(frame_num >= m_params.HistorySize())
 	{
 		// project new image into the eigenspace
-		int w = data.cols;
-    int h = data.rows;
-		int ch = data.channels();
-    CvMat* dataPt = cvCreateMat(1, w*h*ch, CV_8UC1); 
-		CvMat data_row;
-    cvGetRow(dataPt, &data_row, 0);
-    cvReshape(&data_row, &data_row, 3, h ); 
-    cvCopy(data.data, &data_row); 
-
-		CvMat* proj = cvCreateMat(1, m_params.EmbeddedDim(), CV_32F);
-		cvProjectPCA(dataPt, m_pcaAvg.data, m_eigenVectors.data, proj);
+		cv::Mat dataPt;
+		GatherPixels(data, m_spans, dataPt);
+
+		cv::Mat proj = m_pca.project(dataPt.reshape(1, 1));
 
 		// reconstruct point
-		CvMat* result = cvCreateMat(1, m_pcaData.cols, CV_32F);
-		cvBackProjectPCA(proj, m_pcaAvg.data, m_eigenVectors.data, result);
+		cv::Mat result = m_pca.backProject(proj);
+		result.convertTo(result, CV_32F);
 
 		// calculate Euclidean distance between new image and its eigenspace projection
-		int index = 0;
-		for(unsigned int r = 0; r < m_params.Height(); ++r)
-		{
-			for(unsigned int c = 0; c < m_params.Width(); ++c)
-			{
-				double dist = 0;
-				bool bgLow = true;
-				bool bgHigh = true;
-				for(int ch = 0; ch < 3; ++ch)
-				{
-					dist = (data.at< RgbPixel >(r,c)[ch] - cvmGet(result,0,index))*(data.at< RgbPixel >(r,c)[ch] - cvmGet(result,0,index));
-					if(dist > m_params.LowThreshold())
-						bgLow = false;
-					if(dist > m_params.HighThreshold())
-						bgHigh = false;
-					index++;
-				}
-				
-				if(!bgLow)
-				{
-					low_threshold_mask.at< uchar >(r,c) = FOREGROUND;
-				}
-				else
-				{
-					low_threshold_mask.at< uchar >(r,c) = BACKGROUND;
-				}
-
-				if(!bgHigh)
-				{
-					high_threshold_mask.at< uchar >(r,c) = FOREGROUND;
-				}
-				else
-				{
-					high_threshold_mask.at< uchar >(r,c) = BACKGROUND;
-				}
-			}
-		}
-		
-		cvReleaseMat(&result);
-		cvReleaseMat(&proj);		
-		cvReleaseMat(&dataPt);
+		const float* reconstructed = result.ptr<float>();
+		DispatchPixelType(data.type(), [&](auto pixel) {
+			SubtractImpl<decltype(pixel)>(data, reconstructed, low_threshold_mask, high_threshold_mask);
+		});
 	}
 	else 
 	{
 		// set entire image to background since there is not enough information yet
-		// to start performing background subtraction
-		for(unsigned int r = 0; r < m_params.Height(); ++r)
-		{
-			for(unsigned int c = 0; c < m_params.Width(); ++c)
-			{
-				low_threshold_mask.at< uchar >(r,c) = BACKGROUND;
-				high_threshold_mask.at< uchar >(r,c) = BACKGROUND;
-			}
-		}
+		// to start performing background subtraction (pixels outside of the process
+		// mask keep their values)
+		low_threshold_mask.setTo(BACKGROUND, m_process_mask);
+		high_threshold_mask.setTo(BACKGROUND, m_process_mask);
 	}
 
 	UpdateHistory(frame_num, data);
 }
 
-void Eigenbackground::UpdateHistory(int frame_num, const RgbImage& new_frame)
+void Eigenbackground::UpdateHistory(int frame_num, const BaseImage& new_frame)
 {
 	if(frame_num < m_params.HistorySize())
 	{
-		cv::Mat src_row;
-        //cvGetRow(m_pcaData.data, &src_row, frame_num);
-        //cvReshape(&src_row, &src_row, 3, new_frame.rows); 
-        //new_frame.copyTo( &src_row );
+		// each frame of the history is stored as a single row of packed pixels
+		cv::Mat packed;
+		GatherPixels(new_frame, m_spans, packed);
+		packed.reshape(1, 1).copyTo(m_pcaData.row(frame_num));
 	}
-}
\ No newline at end of file
+}
+
+template <typename Pixel>
+void Eigenbackground::SubtractImpl(const BaseImage& data, const float* reconstructed,
+																	 BwImage& low_threshold_mask, BwImage& high_threshold_mask)
+{
+	typedef typename Pixel::value_type T;
+	const int channels = Pixel::channels;
+
+	for(const PixelSpan& span : m_spans)
+	{
+		unsigned int r = span.row;
+		int index = span.offset*channels;
+		const T* pixel = data.ptr<T>(r) + span.begin*channels;
+		for(int c = span.begin; c < span.end; ++c)
+		{
+			if(!IsProcessed(r,c))
+			{
+				index += channels;
+				pixel += channels;
+				continue;
+			}
+
+			double dist = 0;
+			bool bgLow = true;
+			bool bgHigh = true;
+			for(int ch = 0; ch < channels; ++ch, ++pixel)
+			{
+				dist = (*pixel - reconstructed[index])*(*pixel - reconstructed[index]);
+				if(dist > m_params.LowThreshold())
+					bgLow = false;
+				if(dist > m_params.HighThreshold())
+					bgHigh = false;
+				index++;
+			}
+			
+			if(!bgLow)
+			{
+				low_threshold_mask.at< uchar >(r,c) = FOREGROUND;
+			}
+			else
+			{
+				low_threshold_mask.at< uchar >(r,c) = BACKGROUND;
+			}
+
+			if(!bgHigh)
+			{
+				high_threshold_mask.at< uchar >(r,c) = FOREGROUND;
+			}
+			else
+			{
+				high_threshold_mask.at< uchar >(r,c) = BACKGROUND;
+			}
+		}
+	}
+}
@@ -42,6 +42,7 @@ Example:
 #ifndef _ELGAMMAL_H_
 #define _ELGAMMAL_H_
 
+#include <opencv2/core.hpp>
 #include "Bgs.hpp"
 
 namespace Algorithms
@@ -79,24 +80,36 @@ public:
 
 	void Initalize(const BgsParams& param);
 
-	void InitModel(const RgbImage& data);
-	void Subtract(int frame_num, const RgbImage& data,  
+	void InitModel(const BaseImage& data);
+	void Subtract(int frame_num, const BaseImage& data,  
 									BwImage& low_threshold_mask, BwImage& high_threshold_mask);	
-	void Update(int frame_num, const RgbImage& data,  const BwImage& update_mask);
+	void Update(int frame_num, const BaseImage& data,  const BwImage& update_mask);
 
-	RgbImage Background() { return m_background; }
+	// The history of the first HistorySize() frames (the rows of m_pcaData) and the eigenspace built
+	// on the next one need whole frames.
+	bool NeedsFullFrame(int frame_num) const { return frame_num <= m_pcaData.rows; }
+
+	BaseImage Background() { return m_background; }
+	void getBackgroundImage(cv::OutputArray backgroundImage) const { m_background.copyTo(backgroundImage); }
 
 private:
-	void UpdateHistory(int frameNum, const RgbImage& newFrame);
+	void UpdateHistory(int frameNum, const BaseImage& newFrame);
+
+	// per-pixel code for pixels of type Pixel (cv::Vec< T, channels > of uchar, ushort or float)
+	template <typename Pixel> void SubtractImpl(const BaseImage& data, const float* reconstructed,
+																							BwImage& low_threshold_mask, BwImage& high_threshold_mask);
 
 	EigenbackgroundParams m_params;
+
+	// Runs of pixels inside the region of interest. The eigenspace only spans these pixels.
+	PixelSpans m_spans;
 	
-    cv::Mat     m_pcaData;
-    cv::Mat     m_pcaAvg;
-	cv::Mat     m_eigenValues; 
-    cv::Mat     m_eigenVectors;
+	// history of frames (one packed frame per row) and the eigenspace build from it
+	ModelArena  m_pcaData_arena;
+	cv::Mat     m_pcaData;
+	cv::PCA     m_pca;
 
-	RgbImage m_background;
+	BaseImage m_background;
 };
 
 };
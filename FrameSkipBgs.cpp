@@ -0,0 +1,148 @@
+/****************************************************************************
+*
+*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+******************************************************************************/
+
+#include <algorithm>
+#include "FrameSkipBgs.hpp"
+
+using namespace Algorithms::BackgroundSubtraction;
+
+FrameSkipBgs::FrameSkipBgs( const cv::Ptr< Bgs >& bgs, int refresh_interval, int motion_threshold ) :
+    m_bgs( bgs ),
+    m_refresh_interval( std::max( refresh_interval, 1 ) ),
+    m_motion_threshold( motion_threshold ),
+    m_skip_update( false ),
+    m_processed_fraction( 1.0 )
+{
+    CV_Assert( !m_bgs.empty() );
+}
+
+void    FrameSkipBgs::Initalize( const BgsParams& param )
+{
+    m_bgs->Initalize( param );
+
+    m_reference.release();
+    m_carried_low_mask.release();
+    m_carried_high_mask.release();
+}
+
+void    FrameSkipBgs::InitModel( const BaseImage& data )
+{
+    m_bgs->InitModel( data );
+    m_reference.release();
+}
+
+bool    FrameSkipBgs::WarpModel( const cv::Mat& transform )
+{
+    if( !m_bgs->WarpModel( transform ) )
+    {
+        m_frame_num = 0;
+        return false;
+    }
+
+    // the reference and the carried masks no longer line up, so the next frame is a full refresh
+    m_reference.release();
+    return true;
+}
+
+bool    FrameSkipBgs::NeedsFullFrame( int frame_num ) const
+{
+    return m_bgs->NeedsFullFrame( frame_num );
+}
+
+int     FrameSkipBgs::DetectMotion( const BaseImage& data )
+{
+    m_motion.create( data.size() );
+
+    int moving = 0;
+    DispatchPixelType( data.type(), [ & ]( auto pixel ) { moving = DetectMotion< decltype( pixel ) >( data ); } );
+    return moving;
+}
+
+template< typename Pixel >
+int     FrameSkipBgs::DetectMotion( const BaseImage& data )
+{
+    int moving = 0;
+    for( int r = 0; r < data.rows; ++r )
+    {
+        const Pixel* pixel = data.ptr< Pixel >( r );
+        const Pixel* reference = m_reference.ptr< Pixel >( r );
+        uchar* motion = m_motion.ptr< uchar >( r );
+
+        for( int c = 0; c < data.cols; ++c )
+        {
+            motion[ c ] = LInfDistance( pixel[ c ], reference[ c ] ) > m_motion_threshold ? FOREGROUND : BACKGROUND;
+            moving += motion[ c ] != BACKGROUND;
+        }
+    }
+
+    return moving;
+}
+
+void    FrameSkipBgs::Subtract( int frame_num, const BaseImage& data,
+                                BwImage& low_threshold_mask, BwImage& high_threshold_mask )
+{
+    // frames the wrapped algorithm needs in full (e.g. the history of Eigenbackground) are refreshed too
+    bool refresh = m_reference.empty() || frame_num % m_refresh_interval == 0 || m_bgs->NeedsFullFrame( frame_num );
+    m_bgs->SetLearningRate( m_learning_rate );
+
+    if( refresh )
+    {
+        // full subtraction
+        m_bgs->SetProcessMask( BwImage() );
+        m_bgs->Subtract( frame_num, data, low_threshold_mask, high_threshold_mask );
+
+        data.copyTo( m_reference );
+        m_skip_update = false;
+        m_processed_fraction = 1.0;
+    }
+    else
+    {
+        // carry the previous classification forward
+        m_carried_low_mask.copyTo( low_threshold_mask );
+        m_carried_high_mask.copyTo( high_threshold_mask );
+
+        int moving = m_motion_threshold < 0 ? 0 : DetectMotion( data );
+        if( moving > 0 )
+        {
+            // subtract only the pixels that changed since they were last processed
+            m_bgs->SetProcessMask( m_motion );
+            m_bgs->Subtract( frame_num, data, low_threshold_mask, high_threshold_mask );
+
+            data.copyTo( m_reference, m_motion );
+        }
+
+        m_skip_update = moving == 0;
+        m_processed_fraction = static_cast< double >( moving ) / data.total();
+    }
+
+    low_threshold_mask.copyTo( m_carried_low_mask );
+    high_threshold_mask.copyTo( m_carried_high_mask );
+}
+
+void    FrameSkipBgs::Update( int frame_num, const BaseImage& data, const BwImage& update_mask )
+{
+    // the process mask set by Subtract() also restricts the update
+    if( !m_skip_update )
+    {
+        m_bgs->Update( frame_num, data, update_mask );
+    }
+}
+
+void    FrameSkipBgs::getBackgroundImage( cv::OutputArray backgroundImage ) const
+{
+    m_bgs->getBackgroundImage( backgroundImage );
+}
@@ -0,0 +1,94 @@
+/****************************************************************************
+*
+*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+******************************************************************************/
+
+/****************************************************************************
+*
+* FrameSkipBgs.hpp
+*
+* Purpose: Temporal subsampling of any BGS algorithm. Every K-th frame is
+*          fully processed. In between, only pixels that changed by more than
+*          a threshold since they were last processed go through the wrapped
+*          algorithm; all other pixels keep their previous classification and
+*          their model is left untouched. Frames the wrapped algorithm needs
+*          in full (see Bgs::NeedsFullFrame) are always fully processed.
+
+Example:
+    Algorithms::BackgroundSubtraction::GrimsonParams params;
+    params.SetFrameSize( width, height );
+    ...
+    cv::Ptr< Algorithms::BackgroundSubtraction::Bgs > gmm( new Algorithms::BackgroundSubtraction::GrimsonGMM() );
+
+    // full refresh every 10 frames, motion gating at an L-inf difference of 15
+    Algorithms::BackgroundSubtraction::FrameSkipBgs bgs( gmm, 10, 15 );
+    bgs.Initalize( params );
+******************************************************************************/
+
+#ifndef _FRAME_SKIP_BGS_H_
+#define _FRAME_SKIP_BGS_H_
+
+#include "Bgs.hpp"
+
+namespace Algorithms
+{
+    namespace BackgroundSubtraction
+    {
+
+        // --- Frame skip scheduler around a BGS algorithm ---
+        class FrameSkipBgs : public Bgs
+        {
+        public:
+            // refresh_interval - every refresh_interval-th frame is fully processed (1 disables skipping)
+            // motion_threshold - L-inf difference to the last processed value above which a pixel is
+            //                    processed on the other frames. A negative value skips them entirely.
+            FrameSkipBgs( const cv::Ptr< Bgs >& bgs, int refresh_interval, int motion_threshold );
+
+            void    Initalize( const BgsParams& param );
+
+            void    InitModel( const BaseImage& data );
+            bool    WarpModel( const cv::Mat& transform );
+            bool    NeedsFullFrame( int frame_num ) const;
+            void    Subtract( int frame_num, const BaseImage& data,
+                              BwImage& low_threshold_mask, BwImage& high_threshold_mask );
+            void    Update( int frame_num, const BaseImage& data, const BwImage& update_mask );
+
+            void    getBackgroundImage( cv::OutputArray backgroundImage ) const;
+
+            // Fraction of the pixels that went through the wrapped algorithm in the last frame.
+            double  ProcessedFraction() const { return m_processed_fraction; }
+
+        private:
+            // Mark pixels that moved away from the reference frame, returns their number.
+            int     DetectMotion( const BaseImage& data );
+            template< typename Pixel > int  DetectMotion( const BaseImage& data );
+
+            cv::Ptr< Bgs >  m_bgs;
+            int             m_refresh_interval;
+            int             m_motion_threshold;
+
+            BaseImage       m_reference;        // value of each pixel when it was last processed
+            BwImage         m_motion;           // pixels processed in the current frame
+            BwImage         m_carried_low_mask;     // masks of the last frame, carried forward
+            BwImage         m_carried_high_mask;
+
+            bool            m_skip_update;
+            double          m_processed_fraction;
+        };
+
+    };
+};
+
+#endif
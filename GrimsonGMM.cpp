@@ -42,14 +42,19 @@
 * Zivkovic's code can be obtained at: www.zoranz.net
 ******************************************************************************/
 
+#include <algorithm>
+#include <cfloat>
+#include <cstring>
+
 #include "GrimsonGMM.hpp"
 
 using namespace Algorithms::BackgroundSubtraction;
 
+template <int CN>
 int compareGMM(const void* _gmm1, const void* _gmm2)
 {
-	GMM gmm1 = *(GMM*)_gmm1;
-	GMM gmm2 = *(GMM*)_gmm2;
+	const GMMGaussian<CN>& gmm1 = *(const GMMGaussian<CN>*)_gmm1;
+	const GMMGaussian<CN>& gmm2 = *(const GMMGaussian<CN>*)_gmm2;
 
 	if(gmm1.significants < gmm2.significants)
 		return 1;
@@ -61,66 +66,168 @@ int compareGMM(const void* _gmm1, const void* _gmm2)
 
 GrimsonGMM::GrimsonGMM()
 {
-	m_modes = NULL;
+	m_modes_per_pixel = NULL;
+
+	m_tiles_per_row = 0;
+	m_tile_stats.tiles = 0;
+	m_tile_stats.skipped = 0;
 }
 
 GrimsonGMM::~GrimsonGMM()
 {
-	if(m_modes != NULL) 
-		delete[] m_modes;
 }
 
 void GrimsonGMM::Initalize(const BgsParams& param)
 {
-	m_params = (GrimsonParams&)param;
+	m_params = dynamic_cast<const GrimsonParams&>(param);
 
 	// Tbf - the threshold
 	m_bg_threshold = 0.75f;	// 1-cf from the paper 
 
 	// Tgenerate - the threshold
 	m_variance = 36.0f;		// sigma for the new mode
+	m_alpha = m_params.Alpha();
+
+	// only pixels inside the region of interest are modelled
+	m_spans = m_params.Roi().Spans(m_params.Width(), m_params.Height());
+	unsigned int num_pixels = SpanPixels(m_spans);
 
 	// GMM for each pixel
-	m_modes = new GMM[m_params.Size()*m_params.MaxModes()];
+	m_modes = m_modes_arena.Create("GrimsonGMM.modes", 1, num_pixels*m_params.MaxModes(), CV_32FC(m_params.Channels() + 3));
 
 	// used modes per pixel
-	//m_modes_per_pixel = cvCreateImage(cvSize(m_params.Width(), m_params.Height()), IPL_DEPTH_8U, 1);
+	m_modes_per_pixel = m_modes_per_pixel_arena.Create("GrimsonGMM.modes_per_pixel", 1, num_pixels, CV_8U).ptr<unsigned char>();
+
+	// decay not yet applied to the weights of each pixel
+	m_decay = m_decay_arena.Create("GrimsonGMM.decay", 1, num_pixels, CV_32F).ptr<float>();
+	std::fill(m_decay, m_decay + num_pixels, 1.0f);
+	m_stable_ratio = sqrt(5*m_variance/4);
+
+	m_background.create(m_params.Height(), m_params.Width(), m_params.Type());
+	m_background.setTo(cv::Scalar::all(BACKGROUND));
+	m_background_dirty = false;
+
+	// tile change detection starts over without a previous frame
+	m_previous.release();
+	m_previous_low.release();
+	m_previous_high.release();
+	m_unchanged_tiles.clear();
+	m_tile_stats.tiles = 0;
+	m_tile_stats.skipped = 0;
+}
+
+BaseImage GrimsonGMM::Background()
+{
+	UpdateBackground();
+	return m_background;
+}
 
-	//m_background = cvCreateImage(cvSize(m_params.Width(), m_params.Height()), IPL_DEPTH_8U, 3);
+void GrimsonGMM::getBackgroundImage(cv::OutputArray backgroundImage) const
+{
+	UpdateBackground();
+	m_background.copyTo(backgroundImage);
+}
+
+void GrimsonGMM::UpdateBackground() const
+{
+	if(!m_background_dirty)
+		return;
 
-    m_modes_per_pixel.create( m_params.Width(), m_params.Height() );
-    m_background.create( m_params.Width(), m_params.Height() );
+	DispatchPixelType(m_params.Type(), [&](auto pixel) { UpdateBackgroundImpl<decltype(pixel)>(); });
+	m_background_dirty = false;
 }
 
-RgbImage GrimsonGMM::Background()
+template <typename Pixel>
+void GrimsonGMM::UpdateBackgroundImpl() const
 {
-	return m_background;
+	const GMMGaussian<Pixel::channels>* modes = m_modes.ptr< GMMGaussian<Pixel::channels> >();
+
+	for(const PixelSpan& span : m_spans)
+	{
+		Pixel* background = m_background.ptr< Pixel >(span.row);
+		unsigned int pixel = span.offset;
+		for(int c = span.begin; c < span.end; ++c, ++pixel)
+		{
+			for(int ch = 0; ch < Pixel::channels; ++ch)
+			{
+				background[c][ch] = (typename Pixel::value_type)modes[pixel*m_params.MaxModes()].mu[ch];
+			}
+		}
+	}
 }
 
-void GrimsonGMM::InitModel(const RgbImage& data)
+void GrimsonGMM::InitModel(const BaseImage& data)
 {
-	//m_modes_per_pixel.Clear();
-    m_modes_per_pixel.setTo( BACKGROUND );
+	unsigned int num_pixels = SpanPixels(m_spans);
+	for(unsigned int i = 0; i < num_pixels; ++i)
+	{
+		m_modes_per_pixel[i] = 0;
+	}
+
+	m_modes.setTo(cv::Scalar::all(0));
+	std::fill(m_decay, m_decay + SpanPixels(m_spans), 1.0f);
+	m_background_dirty = true;
+}
 
-	for(unsigned int i = 0; i < m_params.Size()*m_params.MaxModes(); ++i)
+bool GrimsonGMM::WarpModel(const cv::Mat& transform)
+{
+	// nothing to move before Initalize()
+	if(m_spans.empty())
+		return true;
+
+	std::vector<int> sources;
+	WarpSources(transform, m_spans, cv::Size(m_params.Width(), m_params.Height()), sources);
+
+	// the modes of a pixel move together with their count
+	cv::Mat modes_per_pixel(1, (int)sources.size(), CV_8U, m_modes_per_pixel);
+	cv::Mat decay(1, (int)sources.size(), CV_32F, m_decay);
+	WarpPackedRecords(sources, m_params.MaxModes()*m_modes.elemSize(), m_modes);
+	WarpPackedRecords(sources, 1, modes_per_pixel);
+	WarpPackedRecords(sources, sizeof(float), decay);
+
+	// exposed pixels have no mode, so the next frame creates one as it does after InitModel()
+	for(const PixelSpan& span : ExposedSpans(sources, m_spans))
 	{
-		m_modes[i].weight = 0;
-		m_modes[i].variance = 0;
-		m_modes[i].muR = 0;
-		m_modes[i].muG = 0;
-		m_modes[i].muB = 0;
-		m_modes[i].significants = 0;
+		memset(m_modes_per_pixel + span.offset, 0, span.end - span.begin);
+		std::fill(m_decay + span.offset, m_decay + span.offset + span.end - span.begin, 1.0f);
 	}
+
+	// the previous frame no longer lines up with the model
+	m_previous.release();
+
+	m_background_dirty = true;
+
+	return true;
 }
 
-void GrimsonGMM::Update(int frame_num, const RgbImage& data,  const BwImage& update_mask)
+void GrimsonGMM::Update(int frame_num, const BaseImage& data,  const BwImage& update_mask)
 {
 	// it doesn't make sense to have conditional updates in the GMM framework
 }
 
-void GrimsonGMM::SubtractPixel(long posPixel, const RgbPixel& pixel, unsigned char& numModes, 
-																	unsigned char& low_threshold, unsigned char& high_threshold)
+template <typename Pixel>
+void GrimsonGMM::SubtractPixel(long posPixel, const Pixel& pixel, unsigned char& numModes, 
+																	unsigned char& low_threshold, unsigned char& high_threshold,
+																	GmmModeCounts* counts)
 {
+	GMMGaussian<Pixel::channels>* modes = Modes<Pixel::channels>();
+
+	if(m_params.LazyDecay())
+	{
+		float& decay = m_decay[posPixel/m_params.MaxModes()];
+		if(SubtractStablePixel(posPixel, pixel, numModes, decay))
+		{
+			low_threshold = BACKGROUND;
+			high_threshold = BACKGROUND;
+			if(counts)
+				counts->matched++;
+			return;
+		}
+
+		// the exact update works on up to date weights
+		ApplyDecay<Pixel::channels>(posPixel, numModes, decay);
+	}
+
 	// calculate distances to the modes (+ sort???)
 	// here we need to go in descending order!!!
 	long pos;
@@ -128,7 +235,7 @@ void GrimsonGMM::SubtractPixel(long posPixel, const RgbPixel& pixel, unsigned ch
 	bool bBackgroundLow=false;
 	bool bBackgroundHigh=false;
 
-	float fOneMinAlpha = 1-m_params.Alpha();
+	float fOneMinAlpha = 1-m_alpha;
 
 	float totalWeight = 0.0f;
 
@@ -140,7 +247,7 @@ void GrimsonGMM::SubtractPixel(long posPixel, const RgbPixel& pixel, unsigned ch
 		if(sum < m_bg_threshold)
 		{
 			backgroundGaussians++;
-			sum += m_modes[posPixel+i].weight;
+			sum += modes[posPixel+i].weight;
 		}
 		else
 		{
@@ -152,24 +259,23 @@ void GrimsonGMM::SubtractPixel(long posPixel, const RgbPixel& pixel, unsigned ch
 	for (int iModes=0; iModes < numModes; iModes++)
 	{
 		pos=posPixel+iModes;
-		float weight = m_modes[pos].weight;
+		float weight = modes[pos].weight;
 
 		// fit not found yet
 		if (!bFitsPDF)
 		{
 			//check if it belongs to some of the modes
 			//calculate distance
-			float var = m_modes[pos].variance;
-			float muR = m_modes[pos].muR;
-			float muG = m_modes[pos].muG;
-			float muB = m_modes[pos].muB;
-		
-			float dR=muR - pixel(0);
-			float dG=muG - pixel(1);
-			float dB=muB - pixel(2);
+			float var = modes[pos].variance;
 
 			// calculate the squared distance
-			float dist = (dR*dR + dG*dG + dB*dB);
+			float delta[Pixel::channels];
+			float dist = 0;
+			for(int ch = 0; ch < Pixel::channels; ++ch)
+			{
+				delta[ch] = modes[pos].mu[ch] - pixel(ch);
+				dist += delta[ch]*delta[ch];
+			}
 
 			if(dist < m_params.HighThreshold()*var && iModes < backgroundGaussians)
 				bBackgroundHigh = true;
@@ -178,23 +284,26 @@ void GrimsonGMM::SubtractPixel(long posPixel, const RgbPixel& pixel, unsigned ch
 			if(dist < m_params.LowThreshold()*var)
 			{
 				bFitsPDF=true;
+				if(counts)
+					counts->matched++;
 
 				// check if this Gaussian is part of the background model
 				if(iModes < backgroundGaussians) 
 					bBackgroundLow = true;
 
 				//update distribution
-				float k = m_params.Alpha()/weight;
-				weight = fOneMinAlpha*weight + m_params.Alpha();
-				m_modes[pos].weight = weight;
-				m_modes[pos].muR = muR - k*(dR);
-				m_modes[pos].muG = muG - k*(dG);
-				m_modes[pos].muB = muB - k*(dB);
+				float k = m_alpha/weight;
+				weight = fOneMinAlpha*weight + m_alpha;
+				modes[pos].weight = weight;
+				for(int ch = 0; ch < Pixel::channels; ++ch)
+				{
+					modes[pos].mu[ch] -= k*delta[ch];
+				}
 
 				//limit the variance
 				float sigmanew = var + k*(dist-var);
-				m_modes[pos].variance = sigmanew < 4 ? 4 : sigmanew > 5*m_variance ? 5*m_variance : sigmanew;
-				m_modes[pos].significants = m_modes[pos].weight / sqrt(m_modes[pos].variance);
+				modes[pos].variance = sigmanew < 4 ? 4 : sigmanew > 5*m_variance ? 5*m_variance : sigmanew;
+				modes[pos].significants = modes[pos].weight / sqrt(modes[pos].variance);
 			}
 			else
 			{
@@ -203,10 +312,12 @@ void GrimsonGMM::SubtractPixel(long posPixel, const RgbPixel& pixel, unsigned ch
 				{
 					weight=0.0;
 					numModes--;
+					if(counts)
+						counts->pruned++;
 				}
 
-				m_modes[pos].weight = weight;
-				m_modes[pos].significants = m_modes[pos].weight / sqrt(m_modes[pos].variance);
+				modes[pos].weight = weight;
+				modes[pos].significants = modes[pos].weight / sqrt(modes[pos].variance);
 			}
 		}
 		else
@@ -216,9 +327,11 @@ void GrimsonGMM::SubtractPixel(long posPixel, const RgbPixel& pixel, unsigned ch
 			{
 				weight=0.0;
 				numModes--;
+				if(counts)
+					counts->pruned++;
 			}
-			m_modes[pos].weight = weight;
-			m_modes[pos].significants = m_modes[pos].weight / sqrt(m_modes[pos].variance);
+			modes[pos].weight = weight;
+			modes[pos].significants = modes[pos].weight / sqrt(modes[pos].variance);
 		}
 
 		totalWeight += weight;
@@ -228,13 +341,19 @@ void GrimsonGMM::SubtractPixel(long posPixel, const RgbPixel& pixel, unsigned ch
 	double invTotalWeight = 1.0 / totalWeight;
 	for (int iLocal = 0; iLocal < numModes; iLocal++)
 	{
-		m_modes[posPixel + iLocal].weight *= (float)invTotalWeight;
-		m_modes[posPixel + iLocal].significants = m_modes[posPixel + iLocal].weight 
-																								/ sqrt(m_modes[posPixel + iLocal].variance);
+		modes[posPixel + iLocal].weight *= (float)invTotalWeight;
+		modes[posPixel + iLocal].significants = modes[posPixel + iLocal].weight 
+																								/ sqrt(modes[posPixel + iLocal].variance);
 	}
 
 	// Sort significance values so they are in desending order. 
-	qsort(&m_modes[posPixel],  numModes, sizeof(GMM), compareGMM);
+	qsort(&modes[posPixel],  numModes, sizeof(modes[0]), compareGMM<Pixel::channels>);
+
+	// shadow test of foreground pixels against the background modes before a mode is created
+	// for an unmatched pixel, since a mode at the pixel itself would explain it as a shadow
+	float shadowDist = FLT_MAX;
+	if(m_params.ShadowDetection() && !(bBackgroundLow && bBackgroundHigh))
+		shadowDist = ShadowDistance(posPixel, numModes, pixel);
 
 	// make new mode if needed and exit
 	if (!bFitsPDF)
@@ -242,45 +361,50 @@ void GrimsonGMM::SubtractPixel(long posPixel, const RgbPixel& pixel, unsigned ch
 		if (numModes < m_params.MaxModes())
 		{
 			numModes++;
+			if(counts)
+				counts->added++;
 		}
 		else
 		{
 			// the weakest mode will be replaced
+			if(counts)
+				counts->replaced++;
 		}
 
 		pos = posPixel + numModes-1;
 		
-		m_modes[pos].muR = pixel[0];
-		m_modes[pos].muG = pixel[1];
-		m_modes[pos].muB = pixel[2];
-		m_modes[pos].variance = m_variance;
-		m_modes[pos].significants = 0;			// will be set below
+		for(int ch = 0; ch < Pixel::channels; ++ch)
+		{
+			modes[pos].mu[ch] = pixel[ch];
+		}
+		modes[pos].variance = m_variance;
+		modes[pos].significants = 0;			// will be set below
 
     if (numModes==1)
-			m_modes[pos].weight = 1;
+			modes[pos].weight = 1;
 		else
-			m_modes[pos].weight = m_params.Alpha();
+			modes[pos].weight = m_alpha;
 
 		//renormalize weights
 		int iLocal;
 		float sum = 0.0;
 		for (iLocal = 0; iLocal < numModes; iLocal++)
 		{
-			sum += m_modes[posPixel+ iLocal].weight;
+			sum += modes[posPixel+ iLocal].weight;
 		}
 
 		double invSum = 1.0/sum;
 		for (iLocal = 0; iLocal < numModes; iLocal++)
 		{
-			m_modes[posPixel + iLocal].weight *= (float)invSum;
-			m_modes[posPixel + iLocal].significants = m_modes[posPixel + iLocal].weight 
-																								/ sqrt(m_modes[posPixel + iLocal].variance);
+			modes[posPixel + iLocal].weight *= (float)invSum;
+			modes[posPixel + iLocal].significants = modes[posPixel + iLocal].weight 
+																								/ sqrt(modes[posPixel + iLocal].variance);
 
 		}
 	}
 
 	// Sort significance values so they are in desending order. 
-	qsort(&(m_modes[posPixel]), numModes, sizeof(GMM), compareGMM);
+	qsort(&(modes[posPixel]), numModes, sizeof(modes[0]), compareGMM<Pixel::channels>);
 
 	if(bBackgroundLow)
 	{
@@ -299,6 +423,182 @@ void GrimsonGMM::SubtractPixel(long posPixel, const RgbPixel& pixel, unsigned ch
 	{
 		high_threshold = FOREGROUND;
 	}
+
+	// relabel foreground that is a shadow on the background (only paid for by foreground pixels)
+	if(low_threshold == FOREGROUND && shadowDist < m_params.LowThreshold())
+		low_threshold = SHADOW;
+	if(high_threshold == FOREGROUND && shadowDist < m_params.HighThreshold())
+		high_threshold = SHADOW;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// A pixel matching its dominant mode (the first one) changes the mixture in a way that can be 
+// deferred: the dominant mode is updated and all weights decay, w0 -> (1-alpha)*w0 + alpha and
+// wi -> (1-alpha)*wi, which keeps their sum at one. After k such frames the complement 1-w0 and 
+// the other weights are the stored ones times the product of the k factors (1-alpha), so only 
+// that product is kept until the next frame needing the whole mixture.
+//
+// The fast path is only taken if the dominant weight is at least m_stable_ratio times the next
+// one. Since the dominant weight only grows and the others only shrink meanwhile, the exact 
+// update could not have reordered the modes either, so it would have matched the same mode and
+// produced the same labels. Error bound against the exact update: means and variances get the
+// same updates, the weights are equal up to floating point rounding (the exact update rounds a 
+// renormalization per frame, a relative error of about k*6e-8 after k deferred frames), and a
+// label can only differ where such a rounding difference crosses a threshold.
+///////////////////////////////////////////////////////////////////////////////
+template <typename Pixel>
+bool GrimsonGMM::SubtractStablePixel(long posPixel, const Pixel& pixel, unsigned char numModes, float& decay)
+{
+	if(numModes == 0)
+		return false;
+
+	GMMGaussian<Pixel::channels>& mode = Modes<Pixel::channels>()[posPixel];
+	float weight = 1 - decay*(1 - mode.weight);
+	if(numModes > 1 && weight < m_stable_ratio*decay*Modes<Pixel::channels>()[posPixel+1].weight)
+		return false;
+
+	// the pixel must be background for both thresholds
+	float var = mode.variance;
+	float delta[Pixel::channels];
+	float dist = 0;
+	for(int ch = 0; ch < Pixel::channels; ++ch)
+	{
+		delta[ch] = mode.mu[ch] - pixel(ch);
+		dist += delta[ch]*delta[ch];
+	}
+
+	if(dist >= std::min(m_params.LowThreshold(), m_params.HighThreshold())*var)
+		return false;
+
+	// same update of the dominant mode as SubtractPixel(), the weights only decay
+	float k = m_alpha/weight;
+	for(int ch = 0; ch < Pixel::channels; ++ch)
+	{
+		mode.mu[ch] -= k*delta[ch];
+	}
+
+	float sigmanew = var + k*(dist-var);
+	mode.variance = sigmanew < 4 ? 4 : sigmanew > 5*m_variance ? 5*m_variance : sigmanew;
+
+	decay *= 1-m_alpha;
+	return true;
+}
+
+template <int CN>
+void GrimsonGMM::ApplyDecay(long posPixel, unsigned char numModes, float& decay)
+{
+	if(decay == 1.0f)
+		return;
+
+	GMMGaussian<CN>* modes = Modes<CN>() + posPixel;
+	for(int i = 0; i < numModes; ++i)
+	{
+		modes[i].weight = i == 0 ? 1 - decay*(1 - modes[i].weight) : decay*modes[i].weight;
+		modes[i].significants = modes[i].weight / sqrt(modes[i].variance);
+	}
+
+	decay = 1.0f;
+}
+
+template <typename Pixel>
+float GrimsonGMM::ShadowDistance(long posPixel, unsigned char numModes, const Pixel& pixel)
+{
+	const GMMGaussian<Pixel::channels>* modes = Modes<Pixel::channels>() + posPixel;
+
+	// A shadow scales the background by a factor a between ShadowRatio() and 1. For each
+	// background mode, a is the least squares fit of the scaled mean to the pixel and the 
+	// distance of the scaled mode to the pixel is measured in scaled variances.
+	float best = FLT_MAX;
+	float sum = 0.0f;
+	for(int i = 0; i < numModes && sum < m_bg_threshold; ++i)
+	{
+		float numerator = 0.0f;
+		float denominator = 0.0f;
+		for(int ch = 0; ch < Pixel::channels; ++ch)
+		{
+			numerator += modes[i].mu[ch]*pixel[ch];
+			denominator += modes[i].mu[ch]*modes[i].mu[ch];
+		}
+
+		if(denominator > 0 && numerator <= denominator && numerator >= m_params.ShadowRatio()*denominator)
+		{
+			float a = numerator / denominator;
+			float dist = 0.0f;
+			for(int ch = 0; ch < Pixel::channels; ++ch)
+			{
+				float delta = a*modes[i].mu[ch] - pixel[ch];
+				dist += delta*delta;
+			}
+			best = std::min(best, dist / (modes[i].variance*a*a));
+		}
+
+		sum += modes[i].weight;
+	}
+
+	return best;
+}
+
+template <int CN>
+void GrimsonGMM::DecayPixel(long posPixel, unsigned char numModes)
+{
+	// An unchanged background pixel is assumed to match its most significant mode again. 
+	// The mean and variance of that mode are left untouched, since the pixel is within the
+	// noise threshold of the frame it was last fully processed with. Only the most significant 
+	// mode gains weight so the weights still sum to one and the order of the modes is kept.
+	float fOneMinAlpha = 1-m_alpha;
+	for(int i = 0; i < numModes; ++i)
+	{
+		GMMGaussian<CN>& mode = Modes<CN>()[posPixel+i];
+		mode.weight *= fOneMinAlpha;
+		if(i == 0)
+			mode.weight += m_alpha;
+
+		mode.significants = mode.weight / sqrt(mode.variance);
+	}
+}
+
+void GrimsonGMM::DetectUnchangedTiles(const BaseImage& data)
+{
+	int tile_size = m_params.TileSize();
+	int width = (int)m_params.Width();
+	int height = (int)m_params.Height();
+	m_tiles_per_row = (width + tile_size - 1) / tile_size;
+	int tiles_per_col = (height + tile_size - 1) / tile_size;
+
+	m_unchanged_tiles.assign(m_tiles_per_row*tiles_per_col, 0);
+	m_tile_stats.tiles = (unsigned int)m_unchanged_tiles.size();
+	m_tile_stats.skipped = 0;
+
+	// the first frame has nothing to be compared against
+	if(m_previous.empty() || m_previous_low.empty())
+	{
+		data.copyTo(m_previous);
+		return;
+	}
+
+	// The reference of a tile is the frame it was last fully processed with, not simply the 
+	// previous frame. Otherwise slow changes (e.g., illumination) would never exceed the 
+	// threshold and would never reach the model.
+	for(int ty = 0; ty < tiles_per_col; ++ty)
+	{
+		for(int tx = 0; tx < m_tiles_per_row; ++tx)
+		{
+			cv::Rect tile(tx*tile_size, ty*tile_size, 
+										std::min(tile_size, width - tx*tile_size),
+										std::min(tile_size, height - ty*tile_size));
+
+			double sad = cv::norm(data(tile), m_previous(tile), cv::NORM_L1);
+			if(sad < m_params.TileThreshold()*tile.area()*data.channels())
+			{
+				m_unchanged_tiles[ty*m_tiles_per_row + tx] = 1;
+				m_tile_stats.skipped++;
+			}
+			else
+			{
+				data(tile).copyTo(m_previous(tile));
+			}
+		}
+	}
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -309,29 +609,86 @@ void GrimsonGMM::SubtractPixel(long posPixel, const RgbPixel& pixel, unsigned ch
 //					(the memory should already be reserved) 
 //					values: 255-foreground, 125-shadow, 0-background
 ///////////////////////////////////////////////////////////////////////////////
-void GrimsonGMM::Subtract(int frame_num, const RgbImage& data,  
+void GrimsonGMM::Subtract(int frame_num, const BaseImage& data,  
 														BwImage& low_threshold_mask, BwImage& high_threshold_mask)
+{
+	CV_Assert(data.type() == m_params.Type());
+
+	m_alpha = FrameAlpha(m_params.Alpha());
+
+	// pixels outside of the region of interest are background (masks passed to a call
+	// restricted by a process mask already hold the previous, cleared, values)
+	if(!m_params.Roi().Empty() && m_process_mask.empty())
+	{
+		low_threshold_mask.setTo(BACKGROUND);
+		high_threshold_mask.setTo(BACKGROUND);
+	}
+
+	// find tiles which are unchanged since they were last processed
+	bool tiles = m_params.TileSize() > 0;
+	if(tiles)
+	{
+		DetectUnchangedTiles(data);
+	}
+
+	DispatchPixelType(data.type(), [&](auto pixel) { SubtractImpl<decltype(pixel)>(data, tiles, low_threshold_mask, high_threshold_mask); });
+
+	// keep the masks for the fast path of the next frame
+	if(tiles)
+	{
+		low_threshold_mask.copyTo(m_previous_low);
+		high_threshold_mask.copyTo(m_previous_high);
+	}
+}
+
+template <typename Pixel>
+void GrimsonGMM::SubtractImpl(const BaseImage& data, bool tiles, 
+															BwImage& low_threshold_mask, BwImage& high_threshold_mask)
 {
 	unsigned char low_threshold, high_threshold;
 	long posPixel;
 
+	// mode changes are only counted while statistics are enabled
+	GmmModeCounts mode_counts;
+	GmmModeCounts* counts = m_stats.empty() ? NULL : &mode_counts;
+
 	// update each pixel of the image
-	for(unsigned int r = 0; r < m_params.Height(); ++r)
+	for(const PixelSpan& span : m_spans)
 	{
-		for(unsigned int c = 0; c < m_params.Width(); ++c)
+		unsigned int r = span.row;
+		unsigned int pixel = span.offset;
+		for(int c = span.begin; c < span.end; ++c, ++pixel)
 		{		
+			if(!IsProcessed(r,c))
+				continue;
+
 			// update model + background subtract
-			posPixel=(r*m_params.Width()+c)*m_params.MaxModes();
+			posPixel=pixel*m_params.MaxModes();
+
+			if(tiles && m_unchanged_tiles[(r/m_params.TileSize())*m_tiles_per_row + c/m_params.TileSize()])
+			{
+				// fast path: reuse the masks of the previous frame
+				low_threshold = m_previous_low.at< uchar >(r,c);
+				high_threshold = m_previous_high.at< uchar >(r,c);
+				low_threshold_mask.at< uchar >(r,c) = low_threshold;
+				high_threshold_mask.at< uchar >(r,c) = high_threshold;
+
+				// foreground pixels would only have their relative weights renormalized
+				if(m_params.TileDecay() && low_threshold == BACKGROUND)
+					DecayPixel<Pixel::channels>(posPixel, m_modes_per_pixel[pixel]);
+
+				continue;
+			}
 			
-			SubtractPixel(posPixel, data.at< RgbPixel >(r,c), m_modes_per_pixel.at< uchar >(r,c), low_threshold, high_threshold);
+			SubtractPixel(posPixel, data.at< Pixel >(r,c), m_modes_per_pixel[pixel], low_threshold, high_threshold, counts);
 			
 			low_threshold_mask.at< uchar >(r,c) = low_threshold;
 			high_threshold_mask.at< uchar >(r,c) = high_threshold;
-
-			m_background.at< RgbPixel >(r,c)[0] = (unsigned char)m_modes[posPixel].muR;
-			m_background.at< RgbPixel >(r,c)[1] = (unsigned char)m_modes[posPixel].muG;
-			m_background.at< RgbPixel >(r,c)[2] = (unsigned char)m_modes[posPixel].muB;
 		}
 	}
-}
 
+	m_background_dirty = true;
+
+	if(counts)
+		m_stats->AddModes(mode_counts);
+}
@@ -56,6 +56,8 @@ Example:
 #ifndef GRIMSON_GMM_
 #define GRIMSON_GMM_
 
+#include <vector>
+
 #include "Bgs.hpp"
 
 namespace Algorithms
@@ -63,26 +65,39 @@ namespace Algorithms
 namespace BackgroundSubtraction
 {
 
-typedef struct GMMGaussian
+// Gaussian component of a pixel with CN channels
+template <int CN>
+struct GMMGaussian
 {
 	float variance;
-	float muR;
-	float muG;
-	float muB;
+	float mu[CN];
 	float weight;
 	float significants;		// this is equal to weight / standard deviation and is used to
 												// determine which Gaussians should be part of the background model
-}GMM;
+};
 
 // --- User adjustable parameters used by the Grimson GMM BGS algorithm ---
 class GrimsonParams : public BgsParams
 {
 public:
+	GrimsonParams() : m_tile_size(0), m_tile_threshold(2.0f), m_tile_decay(false), 
+										m_shadow_detection(false), m_shadow_ratio(0.5f), m_lazy_decay(false) {}
+
 	float &LowThreshold() { return m_low_threshold; }
 	float &HighThreshold() { return m_high_threshold; }
 
 	float &Alpha() { return m_alpha; }
 	int &MaxModes() { return m_max_modes; }
+	int MaxModes() const { return m_max_modes; }
+
+	int &TileSize() { return m_tile_size; }
+	float &TileThreshold() { return m_tile_threshold; }
+	bool &TileDecay() { return m_tile_decay; }
+
+	bool &ShadowDetection() { return m_shadow_detection; }
+	float &ShadowRatio() { return m_shadow_ratio; }
+
+	bool &LazyDecay() { return m_lazy_decay; }
 
 private:
 	// Threshold on the squared dist. to decide when a sample is close to an existing 
@@ -101,6 +116,38 @@ private:
 
 	// Maximum number of modes (Gaussian components) that will be used per pixel
 	int m_max_modes;
+
+	// Side length of the square tiles compared against the previous frame before the
+	// mixture update. A value of 0 disables tile change detection.
+	int m_tile_size;
+
+	// Mean absolute difference (per pixel and channel) below which a tile is considered
+	// unchanged from the previous frame.
+	float m_tile_threshold;
+
+	// Fast path taken by unchanged tiles: if true, the weights of background pixels are
+	// decayed towards their most significant mode; otherwise the tile is skipped entirely.
+	// In both cases the masks of the previous frame are reused.
+	bool m_tile_decay;
+
+	// If true, foreground pixels that are a darkened copy of a background mode are labelled
+	// SHADOW instead of FOREGROUND. A shadow may darken the background down to m_shadow_ratio
+	// of its brightness, and the darkened mode must be within the threshold of the mask.
+	bool m_shadow_detection;
+	float m_shadow_ratio;
+
+	// If true, a pixel matching its dominant mode only updates that mode and defers the decay of
+	// the weights to the next frame that needs the whole mixture (see GrimsonGMM::SubtractStablePixel).
+	bool m_lazy_decay;
+};
+
+// --- Tile change detection statistics of the last processed frame ---
+struct TileStats
+{
+	unsigned int tiles;		// number of tiles compared against the previous frame
+	unsigned int skipped;	// number of tiles which took the fast path
+
+	float SkipRate() const { return tiles > 0 ? (float)skipped / tiles : 0.0f; }
 };
 
 // --- Grimson GMM BGS algorithm ---
@@ -112,16 +159,45 @@ public:
 
 	void Initalize(const BgsParams& param);
 
-	void InitModel(const RgbImage& data);
-	void Subtract(int frame_num, const RgbImage& data,  
+	void InitModel(const BaseImage& data);
+	bool WarpModel(const cv::Mat& transform);
+	void Subtract(int frame_num, const BaseImage& data,  
 									BwImage& low_threshold_mask, BwImage& high_threshold_mask);	
-	void Update(int frame_num, const RgbImage& data,  const BwImage& update_mask);
+	void Update(int frame_num, const BaseImage& data,  const BwImage& update_mask);
+
+	BaseImage Background();
+	void getBackgroundImage(cv::OutputArray backgroundImage) const;
 
-	RgbImage Background();
+	const TileStats& LastTileStats() const { return m_tile_stats; }
 
 private:	
-	void SubtractPixel(long posPixel, const RgbPixel& pixel, unsigned char& numModes, 
-											unsigned char& lowThreshold, unsigned char& highThreshold);
+	// per-pixel code for pixels of type Pixel (cv::Vec< T, channels > of uchar, ushort or float)
+	template <typename Pixel> void SubtractImpl(const BaseImage& data, bool tiles, 
+																							BwImage& low_threshold_mask, BwImage& high_threshold_mask);
+	// counts - mode changes are added to it if not NULL
+	template <typename Pixel> void SubtractPixel(long posPixel, const Pixel& pixel, unsigned char& numModes, 
+																							unsigned char& lowThreshold, unsigned char& highThreshold,
+																							GmmModeCounts* counts);
+	template <int CN> void DecayPixel(long posPixel, unsigned char numModes);
+
+	// Lazy decay: update a pixel matching its dominant mode without touching the other modes and
+	// return true, or return false if the whole mixture is needed. ApplyDecay() brings the weights
+	// of a pixel up to date.
+	template <typename Pixel> bool SubtractStablePixel(long posPixel, const Pixel& pixel, unsigned char numModes, 
+																							float& decay);
+	template <int CN> void ApplyDecay(long posPixel, unsigned char numModes, float& decay);
+
+	// Smallest squared distance, in variances, of a shadowed background mode to the pixel 
+	// (FLT_MAX if no background mode can be shadowed into it)
+	template <typename Pixel> float ShadowDistance(long posPixel, unsigned char numModes, const Pixel& pixel);
+
+	template <int CN> GMMGaussian<CN>* Modes() { return m_modes.ptr< GMMGaussian<CN> >(); }
+
+	// Compute m_background from the model if the model changed since it was last computed
+	void UpdateBackground() const;
+	template <typename Pixel> void UpdateBackgroundImpl() const;
+
+	void DetectUnchangedTiles(const BaseImage& data);
 
 	// User adjustable parameters
 	GrimsonParams m_params;
@@ -132,19 +208,47 @@ private:
 	// it is considered foreground
 	float m_bg_threshold; //1-cf from the paper
 
+	// Learning rate of the current frame
+	float m_alpha;
+
 	// Initial variance for the newly generated components. 
 	// It will will influence the speed of adaptation. A good guess should be made. 
 	// A simple way is to estimate the typical standard deviation from the images.
 	float m_variance;
 
-	// Dynamic array for the mixture of Gaussians
-	GMM* m_modes;
+	// Runs of pixels inside the region of interest. Model arrays only hold these pixels.
+	PixelSpans m_spans;
+
+	// Mixture of Gaussians of each pixel, stored as GMMGaussian<channels> (channels+3 floats per mode)
+	ModelArena m_modes_arena;
+	BaseImage m_modes;
 
 	// Number of Gaussian components per pixel
-	BwImage m_modes_per_pixel;
+	ModelArena m_modes_per_pixel_arena;
+	unsigned char* m_modes_per_pixel;
+
+	// Lazy decay: product of the (1-alpha) factors not yet applied to the weights of each pixel
+	// (1 if none). The weights of the other modes are the stored ones times it, and so is the
+	// complement to one of the weight of the dominant mode.
+	ModelArena m_decay_arena;
+	float* m_decay;
+
+	// Smallest ratio of the dominant weight to the next one that keeps the dominant mode the most
+	// significant for any variance within the limits: sqrt(largest / smallest variance)
+	float m_stable_ratio;
+
+	// Most significant mean of each pixel, computed on request from the model
+	mutable BaseImage m_background;
+	mutable bool m_background_dirty;
 
-	// Current background model
-	RgbImage m_background;
+	// Tile change detection: previous frame and masks, per tile flags (non-zero if the
+	// tile is unchanged) and the statistics of the last frame
+	BaseImage m_previous;
+	BwImage m_previous_low;
+	BwImage m_previous_high;
+	std::vector<uchar> m_unchanged_tiles;
+	int m_tiles_per_row;
+	TileStats m_tile_stats;
 };
 
 };
@@ -0,0 +1,184 @@
+/****************************************************************************
+*
+*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+******************************************************************************/
+
+#include <algorithm>
+#include <cmath>
+#include <opencv2/imgproc.hpp>
+#include "IlluminationBgs.hpp"
+
+using namespace Algorithms::BackgroundSubtraction;
+
+namespace
+{
+    // Thumbnails have at most this many pixels along their longer side.
+    const int THUMBNAIL_SIZE = 64;
+
+    float   Median( std::vector< float >& values )
+    {
+        std::vector< float >::iterator middle = values.begin() + values.size() / 2;
+        std::nth_element( values.begin(), middle, values.end() );
+        return *middle;
+    }
+}
+
+IlluminationBgs::IlluminationBgs( const cv::Ptr< Bgs >& bgs, double tolerance, double adaptation ) :
+    m_bgs( bgs ),
+    m_tolerance( tolerance ),
+    m_adaptation( adaptation ),
+    m_gain( 1.0 ),
+    m_offset( 0.0 ),
+    m_compensated( false )
+{
+    CV_Assert( !m_bgs.empty() );
+}
+
+void    IlluminationBgs::Initalize( const BgsParams& param )
+{
+    m_bgs->Initalize( param );
+    m_reference.release();
+}
+
+void    IlluminationBgs::InitModel( const BaseImage& data )
+{
+    m_bgs->InitModel( data );
+
+    // the model starts out in the illumination of the first frame
+    Thumbnail( data, m_reference );
+    m_gain = 1.0;
+    m_offset = 0.0;
+    m_compensated = false;
+}
+
+bool    IlluminationBgs::WarpModel( const cv::Mat& transform )
+{
+    if( !m_bgs->WarpModel( transform ) )
+    {
+        m_frame_num = 0;
+        return false;
+    }
+
+    // the reference brightness no longer lines up and is taken again from the next frame
+    m_reference.release();
+    m_gain = 1.0;
+    m_offset = 0.0;
+    m_compensated = false;
+    return true;
+}
+
+void    IlluminationBgs::Thumbnail( const BaseImage& data, cv::Mat& thumbnail ) const
+{
+    double scale = std::min( 1.0, static_cast< double >( THUMBNAIL_SIZE ) / std::max( data.cols, data.rows ) );
+    cv::Size size( std::max( cvRound( data.cols * scale ), 1 ), std::max( cvRound( data.rows * scale ), 1 ) );
+
+    cv::Mat small;
+    cv::resize( data, small, size, 0, 0, cv::INTER_AREA );
+    small.convertTo( small, CV_32F );
+
+    // brightness as the sum of the channels
+    thumbnail.create( size, CV_32F );
+    const int channels = small.channels();
+    for( int r = 0; r < size.height; ++r )
+    {
+        const float* pixel = small.ptr< float >( r );
+        float* brightness = thumbnail.ptr< float >( r );
+        for( int c = 0; c < size.width; ++c, pixel += channels )
+        {
+            float sum = 0;
+            for( int ch = 0; ch < channels; ++ch )
+                sum += pixel[ ch ];
+            brightness[ c ] = sum;
+        }
+    }
+}
+
+void    IlluminationBgs::EstimateGain( const cv::Mat& thumbnail )
+{
+    const float* current = thumbnail.ptr< float >();
+    const float* reference = m_reference.ptr< float >();
+    const int count = static_cast< int >( thumbnail.total() );
+
+    // gain from the ratios of the pixels bright enough to have one
+    m_samples.clear();
+    for( int i = 0; i < count; ++i )
+    {
+        if( current[ i ] >= 1.0f )
+            m_samples.push_back( reference[ i ] / current[ i ] );
+    }
+
+    float gain = m_samples.size() * 2 > static_cast< size_t >( count ) ? Median( m_samples ) : 1.0f;
+
+    // offset from the residuals of the gain
+    m_samples.clear();
+    for( int i = 0; i < count; ++i )
+    {
+        m_samples.push_back( reference[ i ] - gain * current[ i ] );
+    }
+    float offset = Median( m_samples );
+
+    m_gain = gain;
+    m_offset = offset;
+}
+
+bool    IlluminationBgs::NeedsFullFrame( int frame_num ) const
+{
+    return m_bgs->NeedsFullFrame( frame_num );
+}
+
+void    IlluminationBgs::Subtract( int frame_num, const BaseImage& data,
+                                   BwImage& low_threshold_mask, BwImage& high_threshold_mask )
+{
+    Thumbnail( data, m_thumbnail );
+    if( m_reference.size() != m_thumbnail.size() )
+    {
+        m_thumbnail.copyTo( m_reference );
+    }
+
+    EstimateGain( m_thumbnail );
+
+    // relative change of the mean brightness the compensation would undo
+    double mean = cv::mean( m_thumbnail )[ 0 ];
+    double change = std::abs( ( m_gain - 1 ) * mean + m_offset ) / std::max( mean, 1.0 );
+    m_compensated = change > m_tolerance;
+
+    if( m_compensated )
+    {
+        // the offset was estimated for the sum of the channels
+        data.convertTo( m_normalized, -1, m_gain, m_offset / data.channels() );
+        cv::addWeighted( m_reference, 1 - m_adaptation, m_thumbnail, m_adaptation * m_gain,
+                         m_adaptation * m_offset, m_reference );
+    }
+    else
+    {
+        m_normalized = data;
+        cv::addWeighted( m_reference, 1 - m_adaptation, m_thumbnail, m_adaptation, 0, m_reference );
+    }
+
+    m_bgs->SetLearningRate( m_learning_rate );
+    m_bgs->SetProcessMask( m_process_mask );
+    m_bgs->Subtract( frame_num, m_normalized, low_threshold_mask, high_threshold_mask );
+}
+
+void    IlluminationBgs::Update( int frame_num, const BaseImage& data, const BwImage& update_mask )
+{
+    // the model learns the normalized frame it was compared against
+    m_bgs->Update( frame_num, m_normalized, update_mask );
+}
+
+void    IlluminationBgs::getBackgroundImage( cv::OutputArray backgroundImage ) const
+{
+    m_bgs->getBackgroundImage( backgroundImage );
+}
@@ -0,0 +1,101 @@
+/****************************************************************************
+*
+*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+******************************************************************************/
+
+/****************************************************************************
+*
+* IlluminationBgs.hpp
+*
+* Purpose: Compensation of global illumination changes for any BGS
+*          algorithm. A cheap pre-pass compares a thumbnail of each frame
+*          with a reference thumbnail of the frames the model has seen and
+*          estimates a global gain and offset as the medians of the pixel
+*          ratios and residuals, which ignore foreground covering less than
+*          half of the frame. If the frame differs from the reference by more
+*          than a tolerance, it is normalized before subtraction and update,
+*          so switching lights or passing clouds do not turn the whole frame
+*          into foreground. Gradual changes are followed by the reference at
+*          the adaptation rate.
+
+Example:
+    auto gmm = Algorithms::BackgroundSubtraction::createBgs( "ZivkovicAGMM", width, height );
+
+    // compensate changes of more than 3% of the mean brightness
+    Algorithms::BackgroundSubtraction::IlluminationBgs bgs( gmm, 0.03 );
+    bgs.apply( frame, fgmask );
+******************************************************************************/
+
+#ifndef _ILLUMINATION_BGS_H_
+#define _ILLUMINATION_BGS_H_
+
+#include <vector>
+#include "Bgs.hpp"
+
+namespace Algorithms
+{
+    namespace BackgroundSubtraction
+    {
+
+        // --- Global gain and offset compensation in front of a BGS algorithm ---
+        class IlluminationBgs : public Bgs
+        {
+        public:
+            // tolerance  - change of the mean brightness, relative to it, below which frames are passed
+            //              through unchanged
+            // adaptation - rate at which the reference follows the compensated frames
+            // The wrapped algorithm may already be initialized (e.g. by createBgs()).
+            IlluminationBgs( const cv::Ptr< Bgs >& bgs, double tolerance = 0.03, double adaptation = 0.05 );
+
+            void    Initalize( const BgsParams& param );
+
+            void    InitModel( const BaseImage& data );
+            bool    WarpModel( const cv::Mat& transform );
+            bool    NeedsFullFrame( int frame_num ) const;
+            void    Subtract( int frame_num, const BaseImage& data,
+                              BwImage& low_threshold_mask, BwImage& high_threshold_mask );
+            void    Update( int frame_num, const BaseImage& data, const BwImage& update_mask );
+
+            void    getBackgroundImage( cv::OutputArray backgroundImage ) const;
+
+            // Compensation of the last frame: data * Gain() + Offset() is passed to the wrapped
+            // algorithm if Compensated() is true.
+            double  Gain() const { return m_gain; }
+            double  Offset() const { return m_offset; }
+            bool    Compensated() const { return m_compensated; }
+
+        private:
+            // Brightness (sum of the channels) of the downsampled frame.
+            void    Thumbnail( const BaseImage& data, cv::Mat& thumbnail ) const;
+            void    EstimateGain( const cv::Mat& thumbnail );
+
+            cv::Ptr< Bgs >  m_bgs;
+            double          m_tolerance;
+            double          m_adaptation;
+
+            cv::Mat         m_thumbnail;
+            cv::Mat         m_reference;        // brightness of the compensated frames
+            std::vector< float >    m_samples;  // scratch buffer of the median estimates
+            BaseImage       m_normalized;       // compensated frame
+
+            double          m_gain;
+            double          m_offset;
+            bool            m_compensated;
+        };
+
+    };
+};
+
+#endif
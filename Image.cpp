@@ -54,4 +54,21 @@ void    DensityFilter( const BwImage & image, BwImage & filtered, int minDensity
             }
         }
     }
-}
\ No newline at end of file
+}
+
+void    ReduceMask( const BwImage & mask, BwImage & reduced, cv::Size size )
+{
+    reduced.create( size );
+    reduced.setTo( 0 );
+
+    for( int r = 0; r < mask.rows; ++r )
+    {
+        const uchar* src = mask.ptr< uchar >( r );
+        uchar* dst = reduced.ptr< uchar >( r * size.height / mask.rows );
+
+        for( int c = 0; c < mask.cols; ++c )
+        {
+            dst[ c * size.width / mask.cols ] |= src[ c ];
+        }
+    }
+}
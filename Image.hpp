@@ -33,6 +33,7 @@ const unsigned char FOREGROUND = 255;
 
 typedef cv::Vec3b   RgbPixel;
 typedef cv::Vec3f   RgbPixelFloat;
+typedef cv::Vec< uchar, 1 > GrayPixel;
 
 // --- Image Types ------------------------------------------------------------
 
@@ -42,10 +43,87 @@ typedef cv::Mat_< unsigned char >   BwImage;
 typedef cv::Mat_< cv::Vec3f >       RgbImageFloat;
 typedef cv::Mat_< float >           BwImageFloat;
 
+// --- Pixel Type Dispatch ----------------------------------------------------
+
+// Calls func with a default constructed pixel (cv::Vec< T, channels >) of the given
+// image type, so generic lambdas can instantiate per-pixel code for the depth and
+// number of channels of the image. Frames may be 8 bit, 16 bit or float with 1, 2
+// (interleaved chroma) or 3 channels.
+template < typename Func >
+void    DispatchPixelType( int type, Func func )
+{
+    switch( type )
+    {
+    case CV_8UC1:
+        func( GrayPixel() );
+        break;
+    case CV_8UC2:
+        func( cv::Vec< uchar, 2 >() );
+        break;
+    case CV_8UC3:
+        func( RgbPixel() );
+        break;
+    case CV_16UC1:
+        func( cv::Vec< ushort, 1 >() );
+        break;
+    case CV_16UC2:
+        func( cv::Vec< ushort, 2 >() );
+        break;
+    case CV_16UC3:
+        func( cv::Vec< ushort, 3 >() );
+        break;
+    case CV_32FC1:
+        func( cv::Vec< float, 1 >() );
+        break;
+    case CV_32FC2:
+        func( cv::Vec< float, 2 >() );
+        break;
+    case CV_32FC3:
+        func( RgbPixelFloat() );
+        break;
+    default:
+        CV_Error( cv::Error::StsUnsupportedFormat, "Only 8 bit, 16 bit and float images with 1, 2 or 3 channels are supported" );
+    }
+}
+
+// --- Pixel Functions --------------------------------------------------------
+
+// Type pixel arithmetic is done in: int for 8 and 16 bit pixels, float for float pixels.
+template < typename Pixel >
+using PixelWork = typename cv::DataType< typename Pixel::value_type >::work_type;
+
+// L-inf distance between two pixels.
+template < typename Pixel >
+PixelWork< Pixel >  LInfDistance( const Pixel& p1, const Pixel& p2 )
+{
+    PixelWork< Pixel > maxDist = 0;
+    for( int ch = 0; ch < Pixel::channels; ++ch )
+    {
+        PixelWork< Pixel > dist = p1[ ch ] > p2[ ch ] ? PixelWork< Pixel >( p1[ ch ] - p2[ ch ] )
+                                                      : PixelWork< Pixel >( p2[ ch ] - p1[ ch ] );
+        if( dist > maxDist )
+            maxDist = dist;
+    }
+
+    return maxDist;
+}
+
+// Value of a channel of type T closest to a model value: integer channels are
+// rounded and saturated to their range, float channels keep the value.
+template < typename T >
+inline T    RoundChannel( double value )
+{
+    return cv::saturate_cast< T >( value );
+}
+
 // --- Image Functions --------------------------------------------------------
 
 void    DensityFilter( const BwImage & image, BwImage & filtered, int minDensity, unsigned char fgValue );
 
+// Reduce a mask to a smaller size. A pixel of the reduced mask is set if any pixel of
+// its block in the mask is set.
+void    ReduceMask( const BwImage & mask, BwImage & reduced, cv::Size size );
+
 #endif
 
 /*
@@ -32,61 +32,145 @@ using namespace Algorithms::BackgroundSubtraction;
 
 void MeanBGS::Initalize(const BgsParams& param)
 {
-	m_params = (MeanParams&)param;
+	m_params = dynamic_cast<const MeanParams&>(param);
 
-	//m_mean = cvCreateImage(cvSize(m_params.Width(), m_params.Height()), IPL_DEPTH_32F, 3);
-	//m_background = cvCreateImage(cvSize(m_params.Width(), m_params.Height()), IPL_DEPTH_8U, 3);
+	// only pixels inside the region of interest are modelled
+	m_spans = m_params.Roi().Spans(m_params.Width(), m_params.Height());
 
-    m_mean.create( m_params.Width(), m_params.Height() );
-    m_background.create( m_params.Width(), m_params.Height() );
+	m_mean = m_mean_arena.Create("MeanBGS.mean", 1, SpanPixels(m_spans), CV_32FC(m_params.Channels()));
+	m_background.create(m_params.Height(), m_params.Width(), m_params.Type());
+	m_background.setTo(cv::Scalar::all(BACKGROUND));
+	m_background_dirty = false;
+	m_exposed.clear();
 }
 
-void MeanBGS::InitModel(const RgbImage& data)
+void MeanBGS::InitModel(const BaseImage& data)
 {
-	for (unsigned int r = 0; r < m_params.Height(); ++r)
+	CV_Assert(data.type() == m_params.Type());
+	DispatchPixelType(data.type(), [&](auto pixel) { InitModelImpl<decltype(pixel)>(data, m_spans); });
+	m_exposed.clear();
+	m_background_dirty = true;
+}
+
+bool MeanBGS::WarpModel(const cv::Mat& transform)
+{
+	// nothing to move before Initalize()
+	if(m_spans.empty())
+		return true;
+
+	std::vector<int> sources;
+	WarpSources(transform, m_spans, cv::Size(m_params.Width(), m_params.Height()), sources);
+	WarpPackedRecords(sources, m_mean.elemSize(), m_mean);
+
+	// exposed pixels are initialized by the next call to Subtract()
+	m_exposed = ExposedSpans(sources, m_spans);
+	m_background_dirty = true;
+
+	return true;
+}
+
+template <typename Pixel>
+void MeanBGS::InitModelImpl(const BaseImage& data, const PixelSpans& spans)
+{
+	typedef cv::Vec<float, Pixel::channels> PixelFloat;
+
+	for(const PixelSpan& span : spans)
 	{
-		for(unsigned int c = 0; c < m_params.Width(); ++c)
+		unsigned int r = span.row;
+		unsigned int pos = span.offset;
+		for(int c = span.begin; c < span.end; ++c, ++pos)
 		{
-			for(int ch = 0; ch < m_mean.channels(); ++ch)
+			for(int ch = 0; ch < Pixel::channels; ++ch)
 			{
-				m_mean.at< RgbPixelFloat >(r,c )[ ch ] = (float)data.at< RgbPixelFloat >(r,c)[ch];
+				m_mean.at< PixelFloat >(pos)[ ch ] = (float)data.at< Pixel >(r,c)[ch];
 			}
 		}
 	}
 }
 
-void MeanBGS::Update(int frame_num, const RgbImage& data,  const BwImage& update_mask)
+void MeanBGS::Update(int frame_num, const BaseImage& data,  const BwImage& update_mask)
+{
+	DispatchPixelType(data.type(), [&](auto pixel) { UpdateImpl<decltype(pixel)>(frame_num, data, update_mask); });
+}
+
+template <typename Pixel>
+void MeanBGS::UpdateImpl(int frame_num, const BaseImage& data,  const BwImage& update_mask)
 {
+	typedef cv::Vec<float, Pixel::channels> PixelFloat;
+
+	// Alpha() is the weight of the previous mean, the learning rate that of the frame (Alpha() is
+	// used as is without a rate, since 1 - (1 - Alpha()) is not Alpha() in float)
+	const float alpha = m_learning_rate < 0 ? m_params.Alpha() : 1.0f - (float)m_learning_rate;
+
 	// update background model
-	for (unsigned int r = 0; r < m_params.Height(); ++r)
+	for(const PixelSpan& span : m_spans)
 	{
-		for(unsigned int c = 0; c < m_params.Width(); ++c)
+		unsigned int r = span.row;
+		unsigned int pos = span.offset;
+		for(int c = span.begin; c < span.end; ++c, ++pos)
 		{
+			if(!IsProcessed(r,c))
+				continue;
+
 			// perform conditional updating only if we are passed the learning phase
 			if(update_mask.at< uchar >(r,c) == BACKGROUND || frame_num < m_params.LearningFrames())
 			{
 				// update B/G model
 				float mean;
-				for(int ch = 0; ch < m_mean.channels(); ++ch)
+				for(int ch = 0; ch < Pixel::channels; ++ch)
 				{
-					mean = m_params.Alpha() * m_mean.at< RgbPixelFloat >( r, c )[ ch ] + (1.0f-m_params.Alpha()) * data.at< RgbPixel >( r, c )[ ch ];
-                    m_mean.at< RgbPixelFloat >( r, c )[ ch ] = mean;
-					m_background.at< RgbPixel >( r, c )[ ch ] = (unsigned char)(mean + 0.5);
+					mean = alpha * m_mean.at< PixelFloat >( pos )[ ch ] + (1.0f-alpha) * data.at< Pixel >( r, c )[ ch ];
+                    m_mean.at< PixelFloat >( pos )[ ch ] = mean;
 				}
 			}
 		}
 	}
+
+	m_background_dirty = true;
+}
+
+void MeanBGS::UpdateBackground() const
+{
+	if(!m_background_dirty)
+		return;
+
+	DispatchPixelType(m_params.Type(), [&](auto pixel) { UpdateBackgroundImpl<decltype(pixel)>(); });
+	m_background_dirty = false;
 }
 
-void MeanBGS::SubtractPixel(int r, int c, const RgbPixel& pixel, 
+template <typename Pixel>
+void MeanBGS::UpdateBackgroundImpl() const
+{
+	typedef cv::Vec<float, Pixel::channels> PixelFloat;
+	const PixelFloat* mean = m_mean.ptr< PixelFloat >();
+
+	for(const PixelSpan& span : m_spans)
+	{
+		Pixel* background = m_background.ptr< Pixel >(span.row);
+		unsigned int pixel = span.offset;
+		for(int c = span.begin; c < span.end; ++c, ++pixel)
+		{
+			for(int ch = 0; ch < Pixel::channels; ++ch)
+			{
+				background[c][ch] = RoundChannel< typename Pixel::value_type >(mean[pixel][ch]);
+			}
+		}
+	}
+}
+
+template <typename Pixel>
+void MeanBGS::SubtractPixel(unsigned int pos, const Pixel& pixel, 
 															unsigned char& low_threshold, 
 															unsigned char& high_threshold)
 {
+	typedef cv::Vec<float, Pixel::channels> PixelFloat;
+	const PixelFloat& mean = m_mean.at< PixelFloat >( pos );
+
 	// calculate distance to sample point
 	float dist = 0;
-	for(int ch = 0; ch < m_mean.channels(); ++ch)
+	for(int ch = 0; ch < Pixel::channels; ++ch)
 	{
-		dist += (pixel(ch)-m_mean.at< RgbPixelFloat >( r, c )[ ch ] )*(pixel(ch)-m_mean.at< RgbPixelFloat >( r, c )[ ch ] );
+		dist += (pixel(ch)-mean[ ch ])*(pixel(ch)-mean[ ch ]);
 	}
 
 	// determine if sample point is F/G or B/G pixel
@@ -105,23 +189,50 @@ void MeanBGS::SubtractPixel(int r, int c, const RgbPixel& pixel,
 
 ///////////////////////////////////////////////////////////////////////////////
 //Input:
-//  data - a pointer to the data of a RGB image of the same size
+//  data - a pointer to the data of a RGB or grayscale image of the same size
 //Output:
 //  output - a pointer to the data of a gray value image of the same size 
 //					values: 255-foreground, 0-background
 ///////////////////////////////////////////////////////////////////////////////
-void MeanBGS::Subtract(int frame_num, const RgbImage& data, 
+void MeanBGS::Subtract(int frame_num, const BaseImage& data, 
 												BwImage& low_threshold_mask, BwImage& high_threshold_mask)
+{
+	CV_Assert(data.type() == m_params.Type());
+
+	// pixels outside of the region of interest are background (masks passed to a call
+	// restricted by a process mask already hold the previous, cleared, values)
+	if(!m_params.Roi().Empty() && m_process_mask.empty())
+	{
+		low_threshold_mask.setTo(BACKGROUND);
+		high_threshold_mask.setTo(BACKGROUND);
+	}
+
+	if(!m_exposed.empty())
+	{
+		DispatchPixelType(data.type(), [&](auto pixel) { InitModelImpl<decltype(pixel)>(data, m_exposed); });
+		m_exposed.clear();
+	}
+
+	DispatchPixelType(data.type(), [&](auto pixel) { SubtractImpl<decltype(pixel)>(data, low_threshold_mask, high_threshold_mask); });
+}
+
+template <typename Pixel>
+void MeanBGS::SubtractImpl(const BaseImage& data, BwImage& low_threshold_mask, BwImage& high_threshold_mask)
 {
 	unsigned char low_threshold, high_threshold;
 
 	// update each pixel of the image
-	for(unsigned int r = 0; r < m_params.Height(); ++r)
+	for(const PixelSpan& span : m_spans)
 	{
-		for(unsigned int c = 0; c < m_params.Width(); ++c)
+		unsigned int r = span.row;
+		unsigned int pos = span.offset;
+		for(int c = span.begin; c < span.end; ++c, ++pos)
 		{	
+			if(!IsProcessed(r,c))
+				continue;
+
 			// perform background subtraction + update background model
-			SubtractPixel(r, c, data.at< RgbPixel >(r,c), low_threshold, high_threshold);
+			SubtractPixel(pos, data.at< Pixel >(r,c), low_threshold, high_threshold);
 
 			// setup silhouette mask
 			low_threshold_mask.at< uchar >(r,c) = low_threshold;
@@ -129,7 +240,3 @@ void MeanBGS::Subtract(int frame_num, const RgbImage& data,
 		}
 	}
 }
-
-
-
-
@@ -76,21 +76,43 @@ public:
 
 	void Initalize(const BgsParams& param);
 
-	void InitModel(const RgbImage& data);
-	void Subtract(int frame_num, const RgbImage& data,  
+	void InitModel(const BaseImage& data);
+	bool WarpModel(const cv::Mat& transform);
+	void Subtract(int frame_num, const BaseImage& data,  
 									BwImage& low_threshold_mask, BwImage& high_threshold_mask);	
-	void Update(int frame_num, const RgbImage& data,  const BwImage& update_mask);
+	void Update(int frame_num, const BaseImage& data,  const BwImage& update_mask);
 
-	RgbImage Background() { return m_background; }
+	BaseImage Background() { UpdateBackground(); return m_background; }
+	void getBackgroundImage(cv::OutputArray backgroundImage) const { UpdateBackground(); m_background.copyTo(backgroundImage); }
 
 private:	
-	void SubtractPixel(int r, int c, const RgbPixel& pixel, 
-											unsigned char& lowThreshold, unsigned char& highThreshold);
+	// per-pixel code for pixels of type Pixel (cv::Vec< T, channels > of uchar, ushort or float)
+	template <typename Pixel> void InitModelImpl(const BaseImage& data, const PixelSpans& spans);
+	template <typename Pixel> void SubtractImpl(const BaseImage& data, 
+																							BwImage& low_threshold_mask, BwImage& high_threshold_mask);
+	template <typename Pixel> void UpdateImpl(int frame_num, const BaseImage& data, const BwImage& update_mask);
+
+	// Compute m_background from the model if the model changed since it was last computed
+	void UpdateBackground() const;
+	template <typename Pixel> void UpdateBackgroundImpl() const;
+
+	template <typename Pixel> void SubtractPixel(unsigned int pos, const Pixel& pixel, 
+																							unsigned char& lowThreshold, unsigned char& highThreshold);
 
 	MeanParams m_params;
 
-	RgbImageFloat m_mean;
-	RgbImage m_background;
+	// Runs of pixels inside the region of interest. The mean only holds these pixels.
+	PixelSpans m_spans;
+
+	// Pixels exposed by the last WarpModel(), initialized from the next frame
+	PixelSpans m_exposed;
+
+	// mean of each pixel with the channels of the frames (CV_32FC1 or CV_32FC3)
+	ModelArena m_mean_arena;
+	BaseImage m_mean;
+	// Mean of each pixel, computed on request from the model
+	mutable BaseImage m_background;
+	mutable bool m_background_dirty;
 };
 
 };
@@ -0,0 +1,176 @@
+/****************************************************************************
+*
+*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+******************************************************************************/
+
+#include <limits>
+#include "ModelPool.hpp"
+#include "Topology.hpp"
+
+using namespace Algorithms::BackgroundSubtraction;
+
+ModelPool&  ModelPool::Instance()
+{
+    static ModelPool pool;
+    return pool;
+}
+
+ModelPool::ModelPool() :
+    m_budget( std::numeric_limits< size_t >::max() ),
+    m_max_cached( 256 << 20 )
+{
+    m_stats.in_use = 0;
+    m_stats.cached = 0;
+    m_stats.hits = 0;
+    m_stats.misses = 0;
+    m_stats.evictions = 0;
+}
+
+ModelPool::~ModelPool()
+{
+    Trim();
+}
+
+void    ModelPool::SetBudget( size_t bytes )
+{
+    std::lock_guard< std::mutex > lock( m_mutex );
+    m_budget = bytes;
+    Evict( m_max_cached, m_budget );
+}
+
+size_t  ModelPool::Budget() const
+{
+    std::lock_guard< std::mutex > lock( m_mutex );
+    return m_budget;
+}
+
+void    ModelPool::SetMaxCached( size_t bytes )
+{
+    std::lock_guard< std::mutex > lock( m_mutex );
+    m_max_cached = bytes;
+    Evict( m_max_cached, m_budget );
+}
+
+size_t  ModelPool::MaxCached() const
+{
+    std::lock_guard< std::mutex > lock( m_mutex );
+    return m_max_cached;
+}
+
+void*   ModelPool::Acquire( const std::string& key, size_t bytes, int& node )
+{
+    node = CurrentNumaNode();
+
+    std::lock_guard< std::mutex > lock( m_mutex );
+
+    for( std::list< Arena >::iterator arena = m_cached.begin(); arena != m_cached.end(); ++arena )
+    {
+        if( arena->bytes == bytes && arena->node == node && arena->key == key )
+        {
+            void* buffer = arena->buffer;
+            m_cached.erase( arena );
+            m_stats.cached -= bytes;
+            m_stats.in_use += bytes;
+            m_stats.hits++;
+            return buffer;
+        }
+    }
+
+    if( bytes > m_budget || m_stats.in_use > m_budget - bytes )
+    {
+        CV_Error( cv::Error::StsNoMem, "Model pool budget exceeded by " + key );
+    }
+
+    // make room for the new arena
+    Evict( m_max_cached, m_budget - bytes );
+
+    void* buffer = cv::fastMalloc( bytes );
+    m_stats.in_use += bytes;
+    m_stats.misses++;
+    return buffer;
+}
+
+void    ModelPool::Release( const std::string& key, size_t bytes, int node, void* buffer )
+{
+    std::lock_guard< std::mutex > lock( m_mutex );
+
+    Arena arena;
+    arena.key = key;
+    arena.bytes = bytes;
+    arena.node = node;
+    arena.buffer = buffer;
+    m_cached.push_front( arena );
+
+    m_stats.in_use -= bytes;
+    m_stats.cached += bytes;
+    Evict( m_max_cached, m_budget );
+}
+
+void    ModelPool::Trim()
+{
+    std::lock_guard< std::mutex > lock( m_mutex );
+    Evict( 0, m_budget );
+}
+
+ModelPoolStats  ModelPool::Stats() const
+{
+    std::lock_guard< std::mutex > lock( m_mutex );
+    return m_stats;
+}
+
+void    ModelPool::Evict( size_t cached, size_t budget )
+{
+    while( !m_cached.empty() && ( m_stats.cached > cached || m_stats.in_use + m_stats.cached > budget ) )
+    {
+        const Arena& arena = m_cached.back();
+        cv::fastFree( arena.buffer );
+        m_stats.cached -= arena.bytes;
+        m_stats.evictions++;
+        m_cached.pop_back();
+    }
+}
+
+ModelArena::ModelArena() :
+    m_bytes( 0 ),
+    m_node( 0 ),
+    m_buffer( NULL )
+{
+}
+
+ModelArena::~ModelArena()
+{
+    Release();
+}
+
+BaseImage   ModelArena::Create( const std::string& key, int rows, int cols, int type )
+{
+    Release();
+
+    m_key = key;
+    m_bytes = static_cast< size_t >( rows ) * cols * CV_ELEM_SIZE( type );
+    m_buffer = ModelPool::Instance().Acquire( m_key, m_bytes, m_node );
+
+    return BaseImage( rows, cols, type, m_buffer );
+}
+
+void    ModelArena::Release()
+{
+    if( m_buffer == NULL )
+        return;
+
+    ModelPool::Instance().Release( m_key, m_bytes, m_node, m_buffer );
+    m_buffer = NULL;
+    m_bytes = 0;
+}
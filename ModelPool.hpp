@@ -0,0 +1,147 @@
+/****************************************************************************
+*
+*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+******************************************************************************/
+
+/****************************************************************************
+*
+* ModelPool.hpp
+*
+* Purpose: Process wide pool of the memory of background models. When a
+*          camera stream goes away, the arenas of its model are kept and
+*          handed to the next model with the same key (algorithm and array)
+*          and size, so streams coming and going reuse memory instead of
+*          returning it to the heap. Kept arenas are evicted least recently
+*          used first. A budget limits the memory of all models of the
+*          process, whether in use or kept. Kept arenas are only reused on
+*          the NUMA node they were first used on.
+
+Example:
+    Algorithms::BackgroundSubtraction::ModelPool::Instance().SetBudget( 2048 << 20 );
+    Algorithms::BackgroundSubtraction::ModelPool::Instance().SetMaxCached( 256 << 20 );
+
+    // in an algorithm
+    ModelArena m_modes_arena;
+    ...
+    m_modes = m_modes_arena.Create( "GrimsonGMM.modes", 1, num_modes, CV_32FC( 6 ) );
+******************************************************************************/
+
+#ifndef _MODEL_POOL_H_
+#define _MODEL_POOL_H_
+
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <string>
+#include "Image.hpp"
+
+namespace Algorithms
+{
+    namespace BackgroundSubtraction
+    {
+
+        // --- Counters of a model pool ---
+        struct ModelPoolStats
+        {
+            size_t  in_use;     // bytes of arenas held by models
+            size_t  cached;     // bytes of arenas kept for reuse
+            size_t  hits;       // arenas reused
+            size_t  misses;     // arenas allocated
+            size_t  evictions;  // kept arenas returned to the heap
+        };
+
+        // --- Recycling allocator for model memory shared by all algorithms ---
+        class ModelPool
+        {
+        public:
+            static ModelPool&   Instance();
+
+            ModelPool();
+            ~ModelPool();
+
+            // Limit of the bytes in use and kept (unlimited by default). Acquire() fails with
+            // cv::Error::StsNoMem if the arenas in use would exceed it.
+            void    SetBudget( size_t bytes );
+            size_t  Budget() const;
+
+            // Limit of the bytes kept for reuse (256 MB by default, 0 disables reuse).
+            void    SetMaxCached( size_t bytes );
+            size_t  MaxCached() const;
+
+            // Buffer of bytes bytes, aligned as by cv::fastMalloc(). A kept arena of the same key and
+            // size on the NUMA node of the calling thread is reused, otherwise kept arenas are evicted
+            // as needed to stay within the budget. Reused buffers keep the contents of their previous
+            // model. New buffers are placed on a node when first written to. Returns the node in node.
+            void*   Acquire( const std::string& key, size_t bytes, int& node );
+
+            // Keep a buffer returned by Acquire() on node for reuse.
+            void    Release( const std::string& key, size_t bytes, int node, void* buffer );
+
+            // Return all kept arenas to the heap.
+            void    Trim();
+
+            ModelPoolStats  Stats() const;
+
+        private:
+            struct Arena
+            {
+                std::string key;
+                size_t      bytes;
+                int         node;
+                void*       buffer;
+            };
+
+            ModelPool( const ModelPool& );
+            ModelPool&  operator=( const ModelPool& );
+
+            // Evict kept arenas, least recently used first, until at most cached bytes are kept
+            // and at most budget bytes are used in total. Called with the mutex locked.
+            void    Evict( size_t cached, size_t budget );
+
+            mutable std::mutex  m_mutex;
+            std::list< Arena >  m_cached;   // most recently released first
+            size_t              m_budget;
+            size_t              m_max_cached;
+            ModelPoolStats      m_stats;
+        };
+
+        // --- Pooled array owned by one model ---
+        class ModelArena
+        {
+        public:
+            ModelArena();
+            ~ModelArena();
+
+            // Matrix of rows x cols elements of type on memory of the pool. The matrix does not own
+            // its memory and is valid until the next call to Create() or Release().
+            BaseImage   Create( const std::string& key, int rows, int cols, int type );
+
+            // Return the memory to the pool.
+            void    Release();
+
+        private:
+            ModelArena( const ModelArena& );
+            ModelArena& operator=( const ModelArena& );
+
+            std::string m_key;
+            size_t      m_bytes;
+            int         m_node;     // NUMA node the arena was acquired on
+            void*       m_buffer;
+        };
+
+    };
+};
+
+#endif
@@ -35,129 +35,147 @@
 * subtraction algorithm.
 ******************************************************************************/
 
+#include <limits>
 #include "PratiMediodBGS.hpp"
 
 using namespace Algorithms::BackgroundSubtraction;
 
 PratiMediodBGS::PratiMediodBGS()
 {
-	m_median_buffer = NULL;
+	m_num_samples = 0;
 }
 
 PratiMediodBGS::~PratiMediodBGS()
 {
-	if(m_median_buffer != NULL)
-		delete[] m_median_buffer;
 }
 
 void PratiMediodBGS::Initalize(const BgsParams& param)
 {
-	m_params = (PratiParams&)param;
-
-	//m_mask_low_threshold = cvCreateImage(cvSize(m_params.Width(), m_params.Height()), IPL_DEPTH_8U, 1);
-	//m_mask_high_threshold = cvCreateImage(cvSize(m_params.Width(), m_params.Height()), IPL_DEPTH_8U, 1);
-    m_mask_low_threshold.create( m_params.Width(), m_params.Height() );
-    m_mask_high_threshold.create( m_params.Width(), m_params.Height() );
-
-	//m_background = cvCreateImage(cvSize(m_params.Width(), m_params.Height()), IPL_DEPTH_8U, 3);
-    m_background.create( m_params.Width(), m_params.Height() );
-
-	m_median_buffer = new MEDIAN_BUFFER[m_params.Size()];
+	m_params = dynamic_cast<const PratiParams&>(param);
+
+	// only pixels inside the region of interest are modelled
+	m_spans = m_params.Roi().Spans(m_params.Width(), m_params.Height());
+	unsigned int num_pixels = SpanPixels(m_spans);
+
+	// pixels outside of the region of interest are never written and stay background
+	m_mask_low_threshold.create(m_params.Height(), m_params.Width());
+	m_mask_low_threshold.setTo(BACKGROUND);
+	m_mask_high_threshold.create(m_params.Height(), m_params.Width());
+	m_mask_high_threshold.setTo(BACKGROUND);
+
+	m_background.create(m_params.Height(), m_params.Width(), m_params.Type());
+	m_background.setTo(cv::Scalar::all(BACKGROUND));
+
+	m_samples = m_samples_arena.Create("PratiMediodBGS.samples", num_pixels, m_params.HistorySize(), m_params.Type());
+	// distances are summed in the arithmetic type of the frames
+	int dist_type = m_params.Depth() == CV_32F ? CV_32F : CV_32S;
+	m_dist = m_dist_arena.Create("PratiMediodBGS.dist", num_pixels, m_params.HistorySize(), dist_type);
+	m_pos.assign(num_pixels, 0);
+	m_num_samples = 0;
+
+	m_median.create(1, num_pixels, m_params.Type());
+	m_median.setTo(cv::Scalar::all(0));
+	m_median_dist.create(1, num_pixels, dist_type);
+	m_median_dist.setTo(0);
 }
 
-void PratiMediodBGS::InitModel(const RgbImage& data)
+void PratiMediodBGS::InitModel(const BaseImage& data)
 {
 	// there is no need to initialize the mode since it needs a buffer of frames
 	// before it can performing background subtraction
 }
 
-void PratiMediodBGS::Update(int frame_num, const RgbImage& data,  const BwImage& update_mask)
+void PratiMediodBGS::Update(int frame_num, const BaseImage& data,  const BwImage& update_mask)
 {
 	// update the image buffer with the new frame and calculate new median values
-	if(frame_num % m_params.SamplingRate() == 0)
+	int sampling_rate = FrameSamplingRate(m_params.SamplingRate());
+	if(sampling_rate > 0 && frame_num % sampling_rate == 0)
 	{
-		if(m_median_buffer[0].dist.size() == m_params.HistorySize())
-		{
-			// subtract distance to sample being removed from all distances
-			for(unsigned int r = 0; r < m_params.Height(); ++r)
-			{
-				for(unsigned int c = 0; c < m_params.Width(); ++c)
-				{	
-					int i = r*m_params.Width()+c;
+		DispatchPixelType(data.type(), [&](auto pixel) { UpdateImpl<decltype(pixel)>(data, update_mask); });
+	}
+}
 
-					if(update_mask.at< uchar >(r,c) == BACKGROUND)
+template <typename Pixel>
+void PratiMediodBGS::UpdateImpl(const BaseImage& data,  const BwImage& update_mask)
+{
+	if(m_num_samples == m_params.HistorySize())
+	{
+		// subtract distance to sample being removed from all distances
+		for(const PixelSpan& span : m_spans)
+		{
+			unsigned int r = span.row;
+			int i = span.offset;
+			for(int c = span.begin; c < span.end; ++c, ++i)
+			{	
+				if(update_mask.at< uchar >(r,c) == BACKGROUND && IsProcessed(r,c))
+				{
+					Pixel* samples = m_samples.ptr< Pixel >(i);
+					PixelWork<Pixel>* sample_dist = m_dist.ptr< PixelWork<Pixel> >(i);
+
+					int oldPos = m_pos[i];
+					for(int s = 0; s < m_num_samples; ++s)
 					{
-						int oldPos = m_median_buffer[i].pos;
-						for(unsigned int s = 0; s < m_median_buffer[i].pixels.size(); ++s)
-						{
-							int maxDist = 0;
-							for(int ch = 0; ch < 3; ++ch) //FIX as m_median_buffer.channels()
-							{
-								int tempDist = abs(m_median_buffer[i].pixels.at(oldPos)(ch) 
-																		- m_median_buffer[i].pixels.at(s)(ch));
-								if(tempDist > maxDist)
-									maxDist = tempDist;
-							}
-
-							m_median_buffer[i].dist.at(s) -= maxDist;
-						}
-				
-						int dist;
-						UpdateMediod(r, c, data, dist);
-						m_median_buffer[i].dist.at(oldPos) = dist;
-						m_median_buffer[i].pixels.at(oldPos) = data.at< RgbPixel >(r,c);
-						m_median_buffer[i].pos++;
-						if(m_median_buffer[i].pos >= m_params.HistorySize())
-							m_median_buffer[i].pos = 0;
+						sample_dist[s] -= LInfDistance(samples[oldPos], samples[s]);
 					}
+			
+					PixelWork<Pixel> dist;
+					UpdateMediod(i, data.at< Pixel >(r,c), dist);
+					sample_dist[oldPos] = dist;
+					samples[oldPos] = data.at< Pixel >(r,c);
+					m_pos[i]++;
+					if(m_pos[i] >= m_params.HistorySize())
+						m_pos[i] = 0;
 				}
 			}
 		}
-		else
+	}
+	else
+	{
+		// calculate sum of L-inf distances for new point and 
+		// add distance from each sample point to this point to their L-inf sum
+		PixelWork<Pixel> dist;
+		for(const PixelSpan& span : m_spans)
 		{
-			// calculate sum of L-inf distances for new point and 
-			// add distance from each sample point to this point to their L-inf sum
-			int dist;
-			for(unsigned int r = 0; r < m_params.Height(); ++r)
-			{
-				for(unsigned int c = 0; c < m_params.Width(); ++c)
-				{	
-					int index = r*m_params.Width()+c;
-					UpdateMediod(r, c, data, dist);
-					m_median_buffer[index].dist.push_back(dist);
-					m_median_buffer[index].pos = 0;
-					m_median_buffer[index].pixels.push_back(data.at< RgbPixel >(r,c)); 
-				}
+			unsigned int r = span.row;
+			int index = span.offset;
+			for(int c = span.begin; c < span.end; ++c, ++index)
+			{	
+				UpdateMediod(index, data.at< Pixel >(r,c), dist);
+				m_dist.at< PixelWork<Pixel> >(index, m_num_samples) = dist;
+				m_pos[index] = 0;
+				m_samples.ptr< Pixel >(index)[m_num_samples] = data.at< Pixel >(r,c); 
 			}
 		}
+
+		m_num_samples++;
 	}
 }
 
-void PratiMediodBGS::UpdateMediod(int r, int c, const RgbImage& new_frame, int& dist)
+template <typename Pixel>
+void PratiMediodBGS::UpdateMediod(unsigned int i, const Pixel& new_pixel, PixelWork<Pixel>& dist)
 {
+	typedef PixelWork<Pixel> Dist;
+
+	const Pixel* samples = m_samples.ptr< Pixel >(i);
+	Dist* sample_dist = m_dist.ptr< Dist >(i);
+	Pixel& median = m_median.at< Pixel >(i);
+	Dist& median_dist = m_median_dist.at< Dist >(i);
+
 	// calculate sum of L-inf distances for new point and 
 	// add distance from each sample point to this point to their L-inf sum
-	unsigned int i = (r*m_params.Width()+c);
-
-	m_median_buffer[i].medianDist = INT_MAX;
+	median_dist = std::numeric_limits<Dist>::max();
 
-	int L_inf_dist = 0;
-	for(unsigned int s = 0; s < m_median_buffer[i].dist.size(); ++s)
+	Dist L_inf_dist = 0;
+	for(int s = 0; s < m_num_samples; ++s)
 	{
-		int maxDist = 0;
-		for(int ch = 0; ch < 3; ++ch) //FIX as .channels()
-		{
-			int tempDist = abs(m_median_buffer[i].pixels.at(s)(ch) - new_frame.at< RgbPixel >(r,c)[ch]);
-			if(tempDist > maxDist)
-				maxDist = tempDist;
-		}
+		Dist maxDist = LInfDistance(samples[s], new_pixel);
 
 		// check if point from this frame in the image buffer is the median
-		m_median_buffer[i].dist.at(s) += maxDist;
-		if(m_median_buffer[i].dist.at(s) < m_median_buffer[i].medianDist)
+		sample_dist[s] += maxDist;
+		if(sample_dist[s] < median_dist)
 		{
-			m_median_buffer[i].medianDist = m_median_buffer[i].dist.at(s);
-			m_median_buffer[i].median = m_median_buffer[i].pixels.at(s);
+			median_dist = sample_dist[s];
+			median = samples[s];
 		}
 
 		L_inf_dist += maxDist;
@@ -166,10 +184,10 @@ void PratiMediodBGS::UpdateMediod(int r, int c, const RgbImage& new_frame, int&
 	dist = L_inf_dist;
 
 	// check if the new point is the median
-	if(L_inf_dist < m_median_buffer[i].medianDist)
+	if(L_inf_dist < median_dist)
 	{
-		m_median_buffer[i].medianDist = L_inf_dist;
-		m_median_buffer[i].median = new_frame.at< RgbPixel >(r,c);
+		median_dist = L_inf_dist;
+		median = new_pixel;
 	}
 }
 
@@ -179,6 +197,10 @@ void PratiMediodBGS::Combine(const BwImage& low_mask, const BwImage& high_mask,
 	{
 		for(unsigned int c = 0; c < m_params.Width(); ++c)
 		{
+			// pixels outside of the process mask keep their previous values
+			if(!IsProcessed(r,c))
+				continue;
+
 			output.at< uchar >(r,c) = BACKGROUND;
 
 			if(r == 0 || c == 0 || r == m_params.Height()-1 || c == m_params.Width()-1)
@@ -214,30 +236,24 @@ void PratiMediodBGS::Combine(const BwImage& low_mask, const BwImage& high_mask,
 	}
 }
 
-void PratiMediodBGS::CalculateMasks(int r, int c, const RgbPixel& pixel)
+template <typename Pixel>
+void PratiMediodBGS::CalculateMasks(int r, int c, unsigned int pos, const Pixel& pixel)
 {
-	int pos = r*m_params.Width()+c;
-
 	// calculate l-inf distance between current value and median value
-	unsigned char dist = 0;
-	for(int ch = 0; ch < 3; ++ch) //FIX as .channels()
-	{
-		int tempDist = abs(pixel(ch) - m_median_buffer[pos].median(ch));
-		if(tempDist > dist)
-			dist = tempDist;
-	}
-	m_background.at< RgbPixel >(r,c) = m_median_buffer[pos].median;
+	const Pixel& median = m_median.at< Pixel >(pos);
+	PixelWork<Pixel> dist = LInfDistance(pixel, median);
+	m_background.at< Pixel >(r,c) = median;
 
 	// check if pixel is a B/G or F/G pixel according to the low threshold B/G model
 	m_mask_low_threshold.at< uchar >(r,c) = BACKGROUND;
-	if(dist > m_params.LowThreshold())
+	if(dist > (PixelWork<Pixel>)m_params.LowThreshold())
 	{
 		m_mask_low_threshold.at< uchar >(r,c) = FOREGROUND;
 	}
 
 	// check if pixel is a B/G or F/G pixel according to the high threshold B/G model
 	m_mask_high_threshold.at< uchar >(r,c)= BACKGROUND;
-	if(dist > m_params.HighThreshold())
+	if(dist > (PixelWork<Pixel>)m_params.HighThreshold())
 	{
 		m_mask_high_threshold.at< uchar >(r,c) = FOREGROUND;
 	}
@@ -245,36 +261,47 @@ void PratiMediodBGS::CalculateMasks(int r, int c, const RgbPixel& pixel)
 
 ///////////////////////////////////////////////////////////////////////////////
 //Input:
-//  data - a pointer to the data of a RGB image of the same size
+//  data - a pointer to the data of a RGB or grayscale image of the same size
 //Output:
 //  output - a pointer to the data of a gray value image of the same size 
 //					values: 255-foreground, 0-background
 ///////////////////////////////////////////////////////////////////////////////
-void PratiMediodBGS::Subtract(int frame_num, const RgbImage& data, 
+void PratiMediodBGS::Subtract(int frame_num, const BaseImage& data, 
 																BwImage& low_threshold_mark, BwImage& high_threshold_mark)
 {
+	CV_Assert(data.type() == m_params.Type());
+
 	if(frame_num < m_params.HistorySize())
 	{
-		low_threshold_mark = 0;
-		high_threshold_mark = 0;
+		// an empty process mask sets every pixel
+		low_threshold_mark.setTo(BACKGROUND, m_process_mask);
+		high_threshold_mark.setTo(BACKGROUND, m_process_mask);
 		return;
 	}
 
-	// update each pixel of the image
-	for(unsigned int r = 0; r < m_params.Height(); ++r)
-	{
-		for(unsigned int c = 0; c < m_params.Width(); ++c)
-		{	
-			// need at least one frame of data before we can start calculating the masks
-			CalculateMasks(r, c, data.at< RgbPixel >(r,c));
-		}
-	}
+	DispatchPixelType(data.type(), [&](auto pixel) { SubtractImpl<decltype(pixel)>(data); });
 
 	// combine low and high threshold masks
+	StageTimer timer(m_stats.get(), &BgsStats::post_process);
 	Combine(m_mask_low_threshold, m_mask_high_threshold, low_threshold_mark);
 	Combine(m_mask_low_threshold, m_mask_high_threshold, high_threshold_mark);
 }
 
+template <typename Pixel>
+void PratiMediodBGS::SubtractImpl(const BaseImage& data)
+{
+	// update each pixel of the image
+	for(const PixelSpan& span : m_spans)
+	{
+		unsigned int r = span.row;
+		unsigned int pos = span.offset;
+		for(int c = span.begin; c < span.end; ++c, ++pos)
+		{	
+			if(!IsProcessed(r,c))
+				continue;
 
-
-
+			// need at least one frame of data before we can start calculating the masks
+			CalculateMasks(r, c, pos, data.at< Pixel >(r,c));
+		}
+	}
+}
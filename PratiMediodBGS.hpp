@@ -94,41 +94,55 @@ private:
 // --- Prati Mediod BGS algorithm ---
 class PratiMediodBGS : public Bgs 
 {
-private:	
-	// sum of L-inf distances from a sample point to all other sample points
-	struct MEDIAN_BUFFER
-	{
-		std::vector<RgbPixel> pixels;		// vector of pixels at give location in image
-		std::vector<int> dist;					// distance from pixel to all other pixels
-		int pos;												// current position in circular buffer
-
-		RgbPixel median;								// median at this pixel location
-		int medianDist;									// distance from median pixel to all other pixels
-	};
-
 public:
 	PratiMediodBGS();
 	~PratiMediodBGS();
 
 	void Initalize(const BgsParams& param);
 
-	void InitModel(const RgbImage& data);
-	void Subtract(int frame_num, const RgbImage& data,  
+	void InitModel(const BaseImage& data);
+	void Subtract(int frame_num, const BaseImage& data,  
 									BwImage& low_threshold_mask, BwImage& high_threshold_mask);	
-	void Update(int frame_num, const RgbImage& data,  const BwImage& update_mask);
+	void Update(int frame_num, const BaseImage& data,  const BwImage& update_mask);
 
-	RgbImage Background() { return m_background; }
+	BaseImage Background() { return m_background; }
+	void getBackgroundImage(cv::OutputArray backgroundImage) const { m_background.copyTo(backgroundImage); }
 
 private:	
-	MEDIAN_BUFFER* m_median_buffer;
+	// per-pixel code for pixels of type Pixel (cv::Vec< T, channels > of uchar, ushort or float)
+	template <typename Pixel> void SubtractImpl(const BaseImage& data);
+	template <typename Pixel> void UpdateImpl(const BaseImage& data, const BwImage& update_mask);
+
+	template <typename Pixel> void CalculateMasks(int r, int c, unsigned int pos, const Pixel& pixel);
+	template <typename Pixel> void UpdateMediod(unsigned int pos, const Pixel& new_pixel, PixelWork<Pixel>& dist);
 
-	void CalculateMasks(int r, int c, const RgbPixel& pixel);
 	void Combine(const BwImage& low_mask, const BwImage& high_mask, BwImage& output);
-	void UpdateMediod(int r, int c, const RgbImage& new_frame, int& dist);
 
 	PratiParams m_params;
+
+	// Runs of pixels inside the region of interest. The median buffer only holds these pixels.
+	PixelSpans m_spans;
+
+	// Circular buffer of samples with one row per pixel and one column per sample
+	ModelArena m_samples_arena;
+	BaseImage m_samples;
+
+	// Sum of L-inf distances from each sample to all other samples of the same pixel
+	// (CV_32S for 8 and 16 bit frames, CV_32F for float frames)
+	ModelArena m_dist_arena;
+	BaseImage m_dist;
+
+	// Current position in the circular buffer of each pixel
+	std::vector<int> m_pos;
+
+	// Number of samples in the buffer
+	int m_num_samples;
+
+	// Mediod of each pixel and the sum of its distances to all other samples
+	BaseImage m_median;
+	BaseImage m_median_dist;
 	
-	RgbImage m_background;
+	BaseImage m_background;
 
 	BwImage m_mask_low_threshold;
 	BwImage m_mask_high_threshold;
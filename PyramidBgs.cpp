@@ -0,0 +1,169 @@
+/****************************************************************************
+*
+*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+******************************************************************************/
+
+#include <algorithm>
+#include <opencv2/imgproc.hpp>
+#include "PyramidBgs.hpp"
+
+using namespace Algorithms::BackgroundSubtraction;
+
+PyramidBgs::PyramidBgs( const cv::Ptr< Bgs >& bgs, int levels, int low_threshold, int high_threshold ) :
+    m_bgs( bgs ),
+    m_levels( std::max( levels, 0 ) ),
+    m_low_threshold( low_threshold ),
+    m_high_threshold( high_threshold ),
+    m_band( 1 << m_levels )
+{
+    CV_Assert( !m_bgs.empty() );
+}
+
+cv::Size    PyramidBgs::LevelSize( cv::Size size, int levels )
+{
+    // same rounding as cv::pyrDown()
+    for( int i = 0; i < levels; ++i )
+    {
+        size = cv::Size( ( size.width + 1 ) / 2, ( size.height + 1 ) / 2 );
+    }
+
+    return size;
+}
+
+void    PyramidBgs::Initalize( const BgsParams& param )
+{
+    m_size = cv::Size( param.Width(), param.Height() );
+    m_level_size = LevelSize( m_size, m_levels );
+
+    m_level_low_threshold_mask.create( m_level_size );
+    m_level_low_threshold_mask.setTo( BACKGROUND );
+    m_level_high_threshold_mask.create( m_level_size );
+    m_level_high_threshold_mask.setTo( BACKGROUND );
+
+    m_level.release();
+    m_background.release();
+}
+
+void    PyramidBgs::Downscale( const BaseImage& data )
+{
+    cv::buildPyramid( data, m_pyramid, m_levels );
+    m_level = m_pyramid[ m_levels ];
+}
+
+void    PyramidBgs::InitModel( const BaseImage& data )
+{
+    Downscale( data );
+    m_bgs->InitModel( m_level );
+}
+
+bool    PyramidBgs::WarpModel( const cv::Mat& transform )
+{
+    // cv::pyrDown() keeps the even pixels, so pixel x of the frame is at x / 2^levels on the level
+    const double scale = 1.0 / m_band;
+    if( !m_bgs->WarpModel( ScaledTransform( transform, scale, scale ) ) )
+    {
+        m_frame_num = 0;
+        return false;
+    }
+
+    return true;
+}
+
+void    PyramidBgs::Refine( const BaseImage& data, BwImage& mask, int threshold )
+{
+    // pixels whose distance to the mask boundary is below the block size of the upsampled mask
+    cv::dilate( mask, m_dilated, cv::Mat(), cv::Point( -1, -1 ), m_band );
+    cv::erode( mask, m_eroded, cv::Mat(), cv::Point( -1, -1 ), m_band );
+
+    DispatchPixelType( data.type(), [ & ]( auto pixel ) { Refine< decltype( pixel ) >( data, mask, threshold ); } );
+}
+
+template< typename Pixel >
+void    PyramidBgs::Refine( const BaseImage& data, BwImage& mask, int threshold )
+{
+    for( int r = 0; r < data.rows; ++r )
+    {
+        const Pixel* pixel = data.ptr< Pixel >( r );
+        const Pixel* background = m_background.ptr< Pixel >( r );
+        const uchar* dilated = m_dilated.ptr< uchar >( r );
+        const uchar* eroded = m_eroded.ptr< uchar >( r );
+        uchar* output = mask.ptr< uchar >( r );
+
+        for( int c = 0; c < data.cols; ++c )
+        {
+            if( dilated[ c ] == eroded[ c ] )
+                continue;
+
+            output[ c ] = LInfDistance( pixel[ c ], background[ c ] ) > threshold ? FOREGROUND : BACKGROUND;
+        }
+    }
+}
+
+bool    PyramidBgs::NeedsFullFrame( int frame_num ) const
+{
+    return m_bgs->NeedsFullFrame( frame_num );
+}
+
+void    PyramidBgs::Subtract( int frame_num, const BaseImage& data,
+                              BwImage& low_threshold_mask, BwImage& high_threshold_mask )
+{
+    CV_Assert( data.size() == m_size );
+
+    Downscale( data );
+
+    m_bgs->SetLearningRate( m_learning_rate );
+    if( m_process_mask.empty() )
+    {
+        m_bgs->SetProcessMask( BwImage() );
+    }
+    else
+    {
+        ReduceMask( m_process_mask, m_level_process_mask, m_level_size );
+        m_bgs->SetProcessMask( m_level_process_mask );
+    }
+
+    m_bgs->Subtract( frame_num, m_level, m_level_low_threshold_mask, m_level_high_threshold_mask );
+
+    // blocky full resolution masks
+    cv::resize( m_level_low_threshold_mask, m_refined_low_mask, m_size, 0, 0, cv::INTER_NEAREST );
+    cv::resize( m_level_high_threshold_mask, m_refined_high_mask, m_size, 0, 0, cv::INTER_NEAREST );
+
+    // reclassify the boundaries at full resolution
+    BaseImage background;
+    m_bgs->getBackgroundImage( background );
+    cv::resize( background, m_background, m_size, 0, 0, cv::INTER_LINEAR );
+
+    Refine( data, m_refined_low_mask, m_low_threshold );
+    Refine( data, m_refined_high_mask, m_high_threshold );
+
+    // pixels outside of the process mask keep their previous values
+    m_refined_low_mask.copyTo( low_threshold_mask, m_process_mask );
+    m_refined_high_mask.copyTo( high_threshold_mask, m_process_mask );
+}
+
+void    PyramidBgs::Update( int frame_num, const BaseImage& data, const BwImage& update_mask )
+{
+    // the level of the frame passed to the last call to Subtract() is reused and a pixel
+    // of the level is only updated if its whole block is background
+    ReduceMask( update_mask, m_level_update_mask, m_level_size );
+    m_bgs->Update( frame_num, m_level, m_level_update_mask );
+}
+
+void    PyramidBgs::getBackgroundImage( cv::OutputArray backgroundImage ) const
+{
+    BaseImage background;
+    m_bgs->getBackgroundImage( background );
+    cv::resize( background, backgroundImage, m_size, 0, 0, cv::INTER_LINEAR );
+}
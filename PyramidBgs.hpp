@@ -0,0 +1,118 @@
+/****************************************************************************
+*
+*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+******************************************************************************/
+
+/****************************************************************************
+*
+* PyramidBgs.hpp
+*
+* Purpose: Multi-resolution mode for any BGS algorithm. The wrapped algorithm
+*          models a downscaled Gaussian pyramid level of the input, which cuts
+*          its memory and compute by 4x per level. The foreground masks are
+*          upsampled to the input resolution and only a band around the
+*          foreground boundaries is refined against the upsampled background.
+
+Example:
+    cv::Size level = Algorithms::BackgroundSubtraction::PyramidBgs::LevelSize( cv::Size( width, height ), 2 );
+
+    // the wrapped algorithm models the pyramid level
+    Algorithms::BackgroundSubtraction::GrimsonParams levelParams;
+    levelParams.SetFrameSize( level.width, level.height );
+    ...
+    cv::Ptr< Algorithms::BackgroundSubtraction::Bgs > gmm( new Algorithms::BackgroundSubtraction::GrimsonGMM() );
+    gmm->Initalize( levelParams );
+
+    // the pyramid works on the full frame
+    Algorithms::BackgroundSubtraction::BgsParams params;
+    params.SetFrameSize( width, height );
+
+    Algorithms::BackgroundSubtraction::PyramidBgs bgs( gmm, 2, 30, 60 );
+    bgs.Initalize( params );
+******************************************************************************/
+
+#ifndef _PYRAMID_BGS_H_
+#define _PYRAMID_BGS_H_
+
+#include <vector>
+#include "Bgs.hpp"
+
+namespace Algorithms
+{
+    namespace BackgroundSubtraction
+    {
+
+        // --- Pyramid level BGS with full resolution boundary refinement ---
+        class PyramidBgs : public Bgs
+        {
+        public:
+            // bgs             - algorithm initialized for the frame size returned by LevelSize()
+            // levels          - number of pyramid levels below the input resolution
+            // low_threshold,
+            // high_threshold  - L-inf distance to the background above which a pixel in the
+            //                   boundary band is foreground in the low and high threshold mask
+            PyramidBgs( const cv::Ptr< Bgs >& bgs, int levels, int low_threshold, int high_threshold );
+
+            // Size of the pyramid level the wrapped algorithm has to be initialized for.
+            static cv::Size LevelSize( cv::Size size, int levels );
+
+            void    Initalize( const BgsParams& param );
+
+            void    InitModel( const BaseImage& data );
+            bool    WarpModel( const cv::Mat& transform );
+            bool    NeedsFullFrame( int frame_num ) const;
+            void    Subtract( int frame_num, const BaseImage& data,
+                              BwImage& low_threshold_mask, BwImage& high_threshold_mask );
+            void    Update( int frame_num, const BaseImage& data, const BwImage& update_mask );
+
+            void    getBackgroundImage( cv::OutputArray backgroundImage ) const;
+
+        private:
+            // Downscale the frame to the pyramid level.
+            void    Downscale( const BaseImage& data );
+
+            // Reclassify the pixels around the boundaries of the upsampled mask.
+            void    Refine( const BaseImage& data, BwImage& mask, int threshold );
+            template< typename Pixel > void Refine( const BaseImage& data, BwImage& mask, int threshold );
+
+            cv::Ptr< Bgs >  m_bgs;
+            int             m_levels;
+            int             m_low_threshold;
+            int             m_high_threshold;
+
+            // width in pixels of the boundary band (the block size of the upsampled mask)
+            int             m_band;
+
+            cv::Size        m_size;
+            cv::Size        m_level_size;
+
+            std::vector< cv::Mat >  m_pyramid;
+            BaseImage       m_level;            // pyramid level of the last subtracted frame
+            BwImage         m_level_low_threshold_mask;
+            BwImage         m_level_high_threshold_mask;
+            BwImage         m_level_process_mask;
+            BwImage         m_level_update_mask;
+
+            BaseImage       m_background;       // upsampled background of the last frame
+            BwImage         m_refined_low_mask;     // full resolution masks of the last frame
+            BwImage         m_refined_high_mask;
+            BwImage         m_dilated;
+            BwImage         m_eroded;
+        };
+
+    };
+};
+
+#endif
@@ -0,0 +1,217 @@
+/****************************************************************************
+*
+*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+******************************************************************************/
+
+#include <cstring>
+#include <vector>
+#include "RegionOfInterest.hpp"
+
+using namespace Algorithms::BackgroundSubtraction;
+
+void    RegionOfInterest::Clear()
+{
+    m_rects.clear();
+    m_exclusion_mask.release();
+}
+
+PixelSpans  RegionOfInterest::Spans( int width, int height ) const
+{
+    PixelSpans spans;
+
+    if( Empty() )
+    {
+        for( int r = 0; r < height; ++r )
+        {
+            PixelSpan span = { r, 0, width, r * width };
+            spans.push_back( span );
+        }
+        return spans;
+    }
+
+    // rasterize the rectangles and the exclusion mask into a single map of active pixels
+    BwImage active( height, width, m_rects.empty() ? FOREGROUND : BACKGROUND );
+    for( const cv::Rect& rect : m_rects )
+    {
+        active( rect & cv::Rect( 0, 0, width, height ) ).setTo( FOREGROUND );
+    }
+
+    if( !m_exclusion_mask.empty() )
+    {
+        CV_Assert( m_exclusion_mask.rows == height && m_exclusion_mask.cols == width );
+        active.setTo( BACKGROUND, m_exclusion_mask );
+    }
+
+    int offset = 0;
+    for( int r = 0; r < height; ++r )
+    {
+        const uchar* row = active.ptr< uchar >( r );
+        for( int c = 0; c < width; )
+        {
+            if( row[ c ] == BACKGROUND )
+            {
+                ++c;
+                continue;
+            }
+
+            PixelSpan span = { r, c, c, offset };
+            while( span.end < width && row[ span.end ] != BACKGROUND )
+            {
+                ++span.end;
+            }
+
+            offset += span.end - span.begin;
+            c = span.end;
+            spans.push_back( span );
+        }
+    }
+
+    return spans;
+}
+
+unsigned int    Algorithms::BackgroundSubtraction::SpanPixels( const PixelSpans& spans )
+{
+    return spans.empty() ? 0 : spans.back().offset + spans.back().end - spans.back().begin;
+}
+
+void    Algorithms::BackgroundSubtraction::GatherPixels( const cv::Mat& image, const PixelSpans& spans, cv::Mat& packed )
+{
+    size_t elem_size = image.elemSize();
+    packed.create( 1, SpanPixels( spans ), image.type() );
+
+    for( const PixelSpan& span : spans )
+    {
+        std::memcpy( packed.ptr() + span.offset * elem_size, image.ptr( span.row ) + span.begin * elem_size,
+                     ( span.end - span.begin ) * elem_size );
+    }
+}
+
+void    Algorithms::BackgroundSubtraction::ScatterPixels( const cv::Mat& packed, const PixelSpans& spans, cv::Size size, cv::Mat& image )
+{
+    size_t elem_size = packed.elemSize();
+    image.create( size, packed.type() );
+    image.setTo( cv::Scalar::all( 0 ) );
+
+    for( const PixelSpan& span : spans )
+    {
+        std::memcpy( image.ptr( span.row ) + span.begin * elem_size, packed.ptr() + span.offset * elem_size,
+                     ( span.end - span.begin ) * elem_size );
+    }
+}
+
+void    Algorithms::BackgroundSubtraction::WarpSources( const cv::Mat& transform, const PixelSpans& spans, cv::Size size, std::vector< int >& sources )
+{
+    CV_Assert( transform.cols == 3 && ( transform.rows == 2 || transform.rows == 3 ) );
+
+    // inverse mapping from the current frame to the previous one
+    cv::Mat forward = cv::Mat::eye( 3, 3, CV_64F );
+    cv::Mat rows = forward.rowRange( 0, transform.rows );
+    transform.convertTo( rows, CV_64F );
+    cv::Mat_< double > inverse = forward.inv();
+
+    // packed index of every pixel of the previous frame (-1 outside of the spans)
+    cv::Mat_< int > index( size, -1 );
+    for( const PixelSpan& span : spans )
+    {
+        int* row = index.ptr< int >( span.row );
+        for( int c = span.begin; c < span.end; ++c )
+        {
+            row[ c ] = span.offset + c - span.begin;
+        }
+    }
+
+    sources.assign( SpanPixels( spans ), -1 );
+    for( const PixelSpan& span : spans )
+    {
+        for( int c = span.begin; c < span.end; ++c )
+        {
+            double w = inverse( 2, 0 ) * c + inverse( 2, 1 ) * span.row + inverse( 2, 2 );
+            if( w <= 0 )
+            {
+                continue;
+            }
+
+            double x = ( inverse( 0, 0 ) * c + inverse( 0, 1 ) * span.row + inverse( 0, 2 ) ) / w;
+            double y = ( inverse( 1, 0 ) * c + inverse( 1, 1 ) * span.row + inverse( 1, 2 ) ) / w;
+            if( x > -0.5 && y > -0.5 && x < size.width - 0.5 && y < size.height - 0.5 )
+            {
+                sources[ span.offset + c - span.begin ] = index( cvRound( y ), cvRound( x ) );
+            }
+        }
+    }
+}
+
+void    Algorithms::BackgroundSubtraction::WarpPackedRecords( const std::vector< int >& sources, size_t record_bytes, cv::Mat& packed )
+{
+    CV_Assert( packed.isContinuous() && packed.total() * packed.elemSize() == sources.size() * record_bytes );
+
+    // records are moved in place, so they are read from a copy of the model
+    std::vector< uchar > previous( packed.ptr(), packed.ptr() + sources.size() * record_bytes );
+
+    for( size_t i = 0; i < sources.size(); ++i )
+    {
+        if( sources[ i ] >= 0 )
+        {
+            std::memcpy( packed.ptr() + i * record_bytes, &previous[ sources[ i ] * record_bytes ], record_bytes );
+        }
+    }
+}
+
+PixelSpans  Algorithms::BackgroundSubtraction::ExposedSpans( const std::vector< int >& sources, const PixelSpans& spans )
+{
+    PixelSpans exposed;
+
+    for( const PixelSpan& span : spans )
+    {
+        for( int c = span.begin; c < span.end; )
+        {
+            if( sources[ span.offset + c - span.begin ] >= 0 )
+            {
+                ++c;
+                continue;
+            }
+
+            PixelSpan run = { span.row, c, c, span.offset + c - span.begin };
+            while( run.end < span.end && sources[ span.offset + run.end - span.begin ] < 0 )
+            {
+                ++run.end;
+            }
+
+            c = run.end;
+            exposed.push_back( run );
+        }
+    }
+
+    return exposed;
+}
+
+cv::Mat     Algorithms::BackgroundSubtraction::ScaledTransform( const cv::Mat& transform, double scale_x, double scale_y )
+{
+    CV_Assert( transform.cols == 3 && ( transform.rows == 2 || transform.rows == 3 ) );
+
+    // element ( i, j ) of S * T * S^-1 is s_i * t_ij / s_j
+    const double scale[ 3 ] = { scale_x, scale_y, 1.0 };
+    cv::Mat_< double > scaled;
+    transform.convertTo( scaled, CV_64F );
+    for( int i = 0; i < scaled.rows; ++i )
+    {
+        for( int j = 0; j < 3; ++j )
+        {
+            scaled( i, j ) *= scale[ i ] / scale[ j ];
+        }
+    }
+
+    return scaled;
+}
@@ -0,0 +1,109 @@
+/****************************************************************************
+*
+*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+******************************************************************************/
+
+/****************************************************************************
+*
+* RegionOfInterest.hpp
+*
+* Purpose: Description of the part of a frame that should be processed by a
+*          BGS algorithm. Algorithms only store a model for the active pixels,
+*          packed in raster order, and leave all other pixels set to background.
+
+Example:
+    Algorithms::BackgroundSubtraction::GrimsonParams params;
+    params.SetFrameSize( width, height );
+    params.Roi().AddRect( cv::Rect( 0, 120, width, height - 120 ) );  // skip the sky
+    params.Roi().SetExclusionMask( timestamp_overlay );                 // non-zero = never processed
+******************************************************************************/
+
+#ifndef _REGION_OF_INTEREST_H_
+#define _REGION_OF_INTEREST_H_
+
+#include <vector>
+#include "Image.hpp"
+
+namespace Algorithms
+{
+    namespace BackgroundSubtraction
+    {
+
+        // --- Run of active pixels [begin, end) on a single row ---
+        struct PixelSpan
+        {
+            int     row;
+            int     begin;
+            int     end;
+            int     offset;     // index of the first pixel of the span in the packed model
+        };
+
+        typedef std::vector< PixelSpan > PixelSpans;
+
+        // --- Region of a frame processed by a BGS algorithm ---
+        class RegionOfInterest
+        {
+        public:
+            // Add a rectangle to process. When rectangles are given only their union is processed,
+            // otherwise the whole frame is.
+            void    AddRect( const cv::Rect& rect ) { m_rects.push_back( rect ); }
+
+            // Pixels set to a non-zero value in the mask are never processed. The mask must be the
+            // size of the frame.
+            void    SetExclusionMask( const BwImage& mask ) { m_exclusion_mask = mask.clone(); }
+
+            void    Clear();
+
+            // True if the whole frame is processed.
+            bool    Empty() const { return m_rects.empty() && m_exclusion_mask.empty(); }
+
+            // Runs of active pixels of a frame, in raster order.
+            PixelSpans  Spans( int width, int height ) const;
+
+        private:
+            std::vector< cv::Rect > m_rects;
+            BwImage                 m_exclusion_mask;
+        };
+
+        // Number of pixels covered by the spans.
+        unsigned int    SpanPixels( const PixelSpans& spans );
+
+        // Copy the active pixels of an image into a packed 1 x N image and back. Pixels of the full
+        // image outside of the spans are set to zero by ScatterPixels.
+        void    GatherPixels( const cv::Mat& image, const PixelSpans& spans, cv::Mat& packed );
+        void    ScatterPixels( const cv::Mat& packed, const PixelSpans& spans, cv::Size size, cv::Mat& image );
+
+        // Packed index of the previous position of each active pixel after a global camera motion.
+        // transform is a 2x3 affine or 3x3 perspective matrix mapping pixels of the previous frame
+        // to the current one and is rounded to the nearest pixel. Pixels exposed by the motion,
+        // whose previous position is outside of the frame or of the spans, get -1.
+        void    WarpSources( const cv::Mat& transform, const PixelSpans& spans, cv::Size size, std::vector< int >& sources );
+
+        // Move the records of a packed model (record_bytes per active pixel) to the positions given by
+        // WarpSources(). Records of exposed pixels are left unchanged.
+        void    WarpPackedRecords( const std::vector< int >& sources, size_t record_bytes, cv::Mat& packed );
+
+        // Runs of the pixels exposed by a motion, with the offsets of the packed model.
+        PixelSpans  ExposedSpans( const std::vector< int >& sources, const PixelSpans& spans );
+
+        // The same motion on an image scaled by scale_x and scale_y, such as a pyramid level or a
+        // subsampled chroma plane: S * transform * S^-1 with S = diag( scale_x, scale_y, 1 ), of the
+        // shape of transform.
+        cv::Mat     ScaledTransform( const cv::Mat& transform, double scale_x, double scale_y );
+
+    };
+};
+
+#endif
@@ -0,0 +1,156 @@
+/****************************************************************************
+*
+*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+******************************************************************************/
+
+#include <algorithm>
+#include <cmath>
+#include <opencv2/imgproc.hpp>
+#include "SyntheticScene.hpp"
+#include "BgsEvaluation.hpp"
+
+using namespace Algorithms::BackgroundSubtraction;
+
+namespace
+{
+    // Position on a path bouncing between 0 and range.
+    double  Bounce( double x, double range )
+    {
+        if( range <= 0 )
+            return 0;
+
+        double m = std::fmod( x, 2 * range );
+        if( m < 0 )
+            m += 2 * range;
+
+        return m <= range ? m : 2 * range - m;
+    }
+
+    // Generator of the random values of a frame, independent of all other frames.
+    cv::RNG     FrameRng( uint64_t seed, int frame_num )
+    {
+        return cv::RNG( ( seed ^ 0x5DEECE66DULL ) * 0x9E3779B97F4A7C15ULL + static_cast< uint64_t >( frame_num ) + 1 );
+    }
+
+    // Camera displacement of a frame, the first values drawn from its generator.
+    cv::Point   CameraDisplacement( cv::RNG& rng, int jitter )
+    {
+        int dx = jitter > 0 ? rng.uniform( -jitter, jitter + 1 ) : 0;
+        int dy = jitter > 0 ? rng.uniform( -jitter, jitter + 1 ) : 0;
+        return cv::Point( dx, dy );
+    }
+}
+
+SyntheticScene::SyntheticScene( const SyntheticSceneParams& params ) :
+    m_params( params ),
+    m_next( 0 )
+{
+    CV_Assert( m_params.Width() > 0 && m_params.Height() > 0 );
+    CV_Assert( m_params.Channels() == 1 || m_params.Channels() == 3 );
+
+    cv::RNG rng( m_params.Seed() );
+    const int jitter = std::max( m_params.Jitter(), 0 );
+    const cv::Size size( m_params.Width() + 2 * jitter, m_params.Height() + 2 * jitter );
+    const int type = CV_8UC( m_params.Channels() );
+
+    // smooth background from a coarse random grid, independent of the resolution
+    cv::Mat coarse( std::max( size.height / 32, 2 ), std::max( size.width / 32, 2 ), type );
+    rng.fill( coarse, cv::RNG::UNIFORM, cv::Scalar::all( 40 ), cv::Scalar::all( 216 ) );
+    cv::resize( coarse, m_background, size, 0, 0, cv::INTER_CUBIC );
+
+    const double scale = std::min( m_params.Width(), m_params.Height() ) * m_params.ObjectSize() / 2;
+    const double speed = m_params.Width() * m_params.ObjectSpeed();
+
+    for( int i = 0; i < m_params.Objects(); ++i )
+    {
+        SceneObject object;
+        object.axes = cv::Size( std::max( cvRound( rng.uniform( 0.3, 1.0 ) * scale ), 1 ),
+                                std::max( cvRound( rng.uniform( 0.3, 1.0 ) * scale ), 1 ) );
+        object.start = cv::Point2d( rng.uniform( 0.0, static_cast< double >( m_params.Width() ) ),
+                                    rng.uniform( 0.0, static_cast< double >( m_params.Height() ) ) );
+        object.velocity = cv::Point2d( rng.uniform( -1.0, 1.0 ) * speed, rng.uniform( -1.0, 1.0 ) * speed );
+        object.color = cv::Scalar( rng.uniform( 0, 256 ), rng.uniform( 0, 256 ), rng.uniform( 0, 256 ) );
+        object.ellipse = rng.uniform( 0, 2 ) == 0;
+        m_objects.push_back( object );
+    }
+}
+
+void    SyntheticScene::Render( int frame_num, cv::Mat& frame, BwImage& truth )
+{
+    cv::RNG rng = FrameRng( m_params.Seed(), frame_num );
+    const int jitter = std::max( m_params.Jitter(), 0 );
+    const int width = m_params.Width();
+    const int height = m_params.Height();
+
+    // camera displacement
+    cv::Point displacement = CameraDisplacement( rng, jitter );
+    const int dx = displacement.x;
+    const int dy = displacement.y;
+    m_background( cv::Rect( jitter + dx, jitter + dy, width, height ) ).copyTo( frame );
+
+    truth.create( height, width );
+    truth.setTo( GT_STATIC );
+
+    // objects bounce off the borders of the frame
+    for( const SceneObject& object : m_objects )
+    {
+        cv::Point center(
+            cvRound( object.axes.width + Bounce( object.start.x + object.velocity.x * frame_num, width - 2 * object.axes.width ) ) - dx,
+            cvRound( object.axes.height + Bounce( object.start.y + object.velocity.y * frame_num, height - 2 * object.axes.height ) ) - dy );
+
+        if( object.ellipse )
+        {
+            cv::ellipse( frame, center, object.axes, 0, 0, 360, object.color, cv::FILLED );
+            cv::ellipse( truth, center, object.axes, 0, 0, 360, cv::Scalar::all( GT_MOTION ), cv::FILLED );
+        }
+        else
+        {
+            cv::Rect rect( center.x - object.axes.width, center.y - object.axes.height,
+                           2 * object.axes.width, 2 * object.axes.height );
+            cv::rectangle( frame, rect, object.color, cv::FILLED );
+            cv::rectangle( truth, rect, cv::Scalar::all( GT_MOTION ), cv::FILLED );
+        }
+    }
+
+    // illumination change
+    if( m_params.IlluminationDrift() != 0 && m_params.IlluminationPeriod() > 0 )
+    {
+        double gain = 1 + m_params.IlluminationDrift() * std::sin( 2 * CV_PI * frame_num / m_params.IlluminationPeriod() );
+        frame.convertTo( frame, -1, gain );
+    }
+
+    // sensor noise
+    if( m_params.Noise() > 0 )
+    {
+        m_noise.create( height, width, CV_16SC( m_params.Channels() ) );
+        rng.fill( m_noise, cv::RNG::NORMAL, cv::Scalar::all( 0 ), cv::Scalar::all( m_params.Noise() ) );
+        cv::add( frame, m_noise, frame, cv::noArray(), frame.type() );
+    }
+}
+
+cv::Mat     SyntheticScene::CameraMotion( int frame_num ) const
+{
+    const int jitter = std::max( m_params.Jitter(), 0 );
+    cv::RNG previous_rng = FrameRng( m_params.Seed(), frame_num - 1 );
+    cv::RNG rng = FrameRng( m_params.Seed(), frame_num );
+    cv::Point motion = CameraDisplacement( previous_rng, jitter ) - CameraDisplacement( rng, jitter );
+
+    cv::Mat_< double > transform( 2, 3, 0.0 );
+    transform( 0, 0 ) = 1;
+    transform( 1, 1 ) = 1;
+    transform( 0, 2 ) = motion.x;
+    transform( 1, 2 ) = motion.y;
+    return transform;
+}
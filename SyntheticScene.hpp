@@ -0,0 +1,160 @@
+/****************************************************************************
+*
+*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+******************************************************************************/
+
+/****************************************************************************
+*
+* SyntheticScene.hpp
+*
+* Purpose: Procedural video with ground truth masks for reproducible tests and
+*          benchmarks. A smooth random background is overlaid with moving
+*          ellipses and rectangles and disturbed by sensor noise, a periodic
+*          illumination change and camera jitter. Every frame is a function of
+*          the parameters (including the seed) and the frame index alone, so
+*          any resolution and length can be generated without stored media.
+*          Ground truth marks the moving objects with GT_MOTION and all other
+*          pixels with GT_STATIC.
+
+Example:
+    Algorithms::BackgroundSubtraction::SyntheticSceneParams params;
+    params.SetFrameSize( 3840, 2160 );
+    params.Noise() = 6;
+    params.Jitter() = 2;
+
+    Algorithms::BackgroundSubtraction::SyntheticScene scene( params );
+
+    cv::Mat frame;
+    BwImage truth;
+    for( int i = 0; i < 300; ++i )
+    {
+        scene.Render( i, frame, truth );
+        ...
+    }
+******************************************************************************/
+
+#ifndef _SYNTHETIC_SCENE_H_
+#define _SYNTHETIC_SCENE_H_
+
+#include <cstdint>
+#include <vector>
+#include "Image.hpp"
+
+namespace Algorithms
+{
+    namespace BackgroundSubtraction
+    {
+
+        // --- Parameters of a synthetic scene ---
+        class SyntheticSceneParams
+        {
+        public:
+            SyntheticSceneParams() :
+                m_width( 640 ),
+                m_height( 480 ),
+                m_channels( 3 ),
+                m_seed( 0 ),
+                m_noise( 4.0 ),
+                m_illumination_drift( 0.1 ),
+                m_illumination_period( 300 ),
+                m_objects( 4 ),
+                m_object_size( 0.1 ),
+                m_object_speed( 0.005 ),
+                m_jitter( 0 )
+            {}
+
+            void    SetFrameSize( int width, int height ) { m_width = width; m_height = height; }
+
+            int         &Width() { return m_width; }
+            int         &Height() { return m_height; }
+            int         &Channels() { return m_channels; }
+            uint64_t    &Seed() { return m_seed; }
+            double      &Noise() { return m_noise; }
+            double      &IlluminationDrift() { return m_illumination_drift; }
+            int         &IlluminationPeriod() { return m_illumination_period; }
+            int         &Objects() { return m_objects; }
+            double      &ObjectSize() { return m_object_size; }
+            double      &ObjectSpeed() { return m_object_speed; }
+            int         &Jitter() { return m_jitter; }
+
+            int         Width() const { return m_width; }
+            int         Height() const { return m_height; }
+            int         Channels() const { return m_channels; }
+            uint64_t    Seed() const { return m_seed; }
+            double      Noise() const { return m_noise; }
+            double      IlluminationDrift() const { return m_illumination_drift; }
+            int         IlluminationPeriod() const { return m_illumination_period; }
+            int         Objects() const { return m_objects; }
+            double      ObjectSize() const { return m_object_size; }
+            double      ObjectSpeed() const { return m_object_speed; }
+            int         Jitter() const { return m_jitter; }
+
+        private:
+            int         m_width;
+            int         m_height;
+            int         m_channels;             // 1 or 3
+            uint64_t    m_seed;
+
+            double      m_noise;                // standard deviation of the sensor noise
+            double      m_illumination_drift;   // amplitude of the sinusoidal change of the brightness (0.1 = 10%)
+            int         m_illumination_period;  // frames per period of the brightness change
+            int         m_objects;              // number of moving objects
+            double      m_object_size;          // largest object diameter as a fraction of the smaller frame dimension
+            double      m_object_speed;         // largest object speed as a fraction of the frame width per frame
+            int         m_jitter;               // largest camera displacement in pixels
+        };
+
+        // --- Procedural video with ground truth ---
+        class SyntheticScene
+        {
+        public:
+            explicit SyntheticScene( const SyntheticSceneParams& params );
+
+            // Render frame frame_num (8 bit with Channels() channels) and its ground truth. Frames
+            // may be rendered in any order.
+            void    Render( int frame_num, cv::Mat& frame, BwImage& truth );
+
+            // Render the frame following the last one returned by Next().
+            void    Next( cv::Mat& frame, BwImage& truth ) { Render( m_next++, frame, truth ); }
+
+            // Translation of the background from frame frame_num - 1 to frame frame_num, as a 2x3
+            // matrix for Bgs::WarpModel().
+            cv::Mat     CameraMotion( int frame_num ) const;
+
+            const SyntheticSceneParams& Params() const { return m_params; }
+
+        private:
+            struct SceneObject
+            {
+                cv::Point2d start;      // position on the path of the center at frame 0
+                cv::Point2d velocity;   // pixels per frame
+                cv::Size    axes;       // half width and half height
+                cv::Scalar  color;
+                bool        ellipse;
+            };
+
+            SyntheticSceneParams        m_params;
+            int                         m_next;
+
+            // background with a border of Jitter() pixels on each side
+            cv::Mat                     m_background;
+            std::vector< SceneObject >  m_objects;
+            cv::Mat                     m_noise;
+        };
+
+    };
+};
+
+#endif
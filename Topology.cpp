@@ -0,0 +1,152 @@
+/****************************************************************************
+*
+*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+******************************************************************************/
+
+#if defined( __linux__ )
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#elif defined( _WIN32 )
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+#include <cstdio>
+#include <map>
+#include <thread>
+#include "Topology.hpp"
+
+using namespace Algorithms::BackgroundSubtraction;
+
+std::vector< int >  Algorithms::BackgroundSubtraction::AvailableCpus()
+{
+    std::vector< int > cpus;
+
+#if defined( __linux__ )
+    cpu_set_t set;
+    if( sched_getaffinity( 0, sizeof( set ), &set ) == 0 )
+    {
+        for( int cpu = 0; cpu < CPU_SETSIZE; ++cpu )
+        {
+            if( CPU_ISSET( cpu, &set ) )
+                cpus.push_back( cpu );
+        }
+    }
+#elif defined( _WIN32 )
+    DWORD_PTR process_mask, system_mask;
+    if( GetProcessAffinityMask( GetCurrentProcess(), &process_mask, &system_mask ) )
+    {
+        for( int cpu = 0; cpu < static_cast< int >( sizeof( DWORD_PTR ) * 8 ); ++cpu )
+        {
+            if( process_mask & ( static_cast< DWORD_PTR >( 1 ) << cpu ) )
+                cpus.push_back( cpu );
+        }
+    }
+#endif
+
+    if( cpus.empty() )
+    {
+        int count = static_cast< int >( std::thread::hardware_concurrency() );
+        for( int cpu = 0; cpu < count || cpu == 0; ++cpu )
+            cpus.push_back( cpu );
+    }
+
+    return cpus;
+}
+
+int     Algorithms::BackgroundSubtraction::NumaNodeOfCpu( int cpu )
+{
+#if defined( __linux__ )
+    // the directory of a processor links to its node
+    char path[ 64 ];
+    for( int node = 0; node < 256; ++node )
+    {
+        std::snprintf( path, sizeof( path ), "/sys/devices/system/cpu/cpu%d/node%d", cpu, node );
+        if( access( path, F_OK ) == 0 )
+            return node;
+    }
+#elif defined( _WIN32 )
+    UCHAR node;
+    if( cpu >= 0 && cpu < 64 && GetNumaProcessorNode( static_cast< UCHAR >( cpu ), &node ) && node != 0xFF )
+        return node;
+#endif
+    return 0;
+}
+
+int     Algorithms::BackgroundSubtraction::CurrentCpu()
+{
+#if defined( __linux__ )
+    return sched_getcpu();
+#elif defined( _WIN32 )
+    return static_cast< int >( GetCurrentProcessorNumber() );
+#else
+    return -1;
+#endif
+}
+
+int     Algorithms::BackgroundSubtraction::CurrentNumaNode()
+{
+    int cpu = CurrentCpu();
+    return cpu < 0 ? 0 : NumaNodeOfCpu( cpu );
+}
+
+bool    Algorithms::BackgroundSubtraction::PinCurrentThread( int cpu )
+{
+#if defined( __linux__ )
+    if( cpu < 0 || cpu >= CPU_SETSIZE )
+        return false;
+
+    cpu_set_t set;
+    CPU_ZERO( &set );
+    CPU_SET( cpu, &set );
+    return pthread_setaffinity_np( pthread_self(), sizeof( set ), &set ) == 0;
+#elif defined( _WIN32 )
+    if( cpu < 0 || cpu >= static_cast< int >( sizeof( DWORD_PTR ) * 8 ) )
+        return false;
+
+    return SetThreadAffinityMask( GetCurrentThread(), static_cast< DWORD_PTR >( 1 ) << cpu ) != 0;
+#else
+    return false;
+#endif
+}
+
+std::vector< int >  Algorithms::BackgroundSubtraction::InterleavedCpus()
+{
+    std::map< int, std::vector< int > > nodes;
+    for( int cpu : AvailableCpus() )
+        nodes[ NumaNodeOfCpu( cpu ) ].push_back( cpu );
+
+    std::vector< int > cpus;
+    for( size_t i = 0; ; ++i )
+    {
+        size_t added = 0;
+        for( const auto& node : nodes )
+        {
+            if( i < node.second.size() )
+            {
+                cpus.push_back( node.second[ i ] );
+                ++added;
+            }
+        }
+        if( added == 0 )
+            break;
+    }
+
+    return cpus;
+}
@@ -0,0 +1,64 @@
+/****************************************************************************
+*
+*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+******************************************************************************/
+
+/****************************************************************************
+*
+* Topology.hpp
+*
+* Purpose: Processors and NUMA nodes of the machine and pinning of threads
+*          to processors. Memory is placed on the NUMA node of the processor
+*          that first writes to it, so a model initialized by a thread pinned
+*          to a processor is local to that processor. On platforms without
+*          support every processor is on node 0 and pinning fails.
+
+Example:
+    std::vector< int > cpus = Algorithms::BackgroundSubtraction::AvailableCpus();
+    Algorithms::BackgroundSubtraction::PinCurrentThread( cpus[ 0 ] );
+    int node = Algorithms::BackgroundSubtraction::CurrentNumaNode();
+******************************************************************************/
+
+#ifndef _TOPOLOGY_H_
+#define _TOPOLOGY_H_
+
+#include <vector>
+
+namespace Algorithms
+{
+    namespace BackgroundSubtraction
+    {
+
+        // Processors the process may run on, in ascending order.
+        std::vector< int >  AvailableCpus();
+
+        // NUMA node of a processor (0 if unknown).
+        int     NumaNodeOfCpu( int cpu );
+
+        // Processor running the calling thread (-1 if unknown) and its NUMA node.
+        int     CurrentCpu();
+        int     CurrentNumaNode();
+
+        // Restrict the calling thread to one processor. Returns false if not supported.
+        bool    PinCurrentThread( int cpu );
+
+        // Processors ordered so that consecutive entries alternate between the NUMA nodes,
+        // which spreads workers assigned in this order over all nodes.
+        std::vector< int >  InterleavedCpus();
+
+    };
+};
+
+#endif
@@ -37,140 +37,232 @@ using namespace Algorithms::BackgroundSubtraction;
 
 WrenGA::WrenGA()
 {
-	m_gaussian = NULL;
 }
 
 WrenGA::~WrenGA()
 {
-	if(m_gaussian != NULL)
-		delete[] m_gaussian;
 }
 
 void WrenGA::Initalize(const BgsParams& param)
 {
-	m_params = (WrenParams&)param;
+	m_params = dynamic_cast<const WrenParams&>(param);
 
 	m_variance = 36.0f;
 
-	// GMM for each pixel
-	m_gaussian = new GAUSSIAN[m_params.Size()];
-	for(unsigned int i = 0; i < m_params.Size(); ++i)
-	{
-		for(int ch = 0; ch < 3; ++ch) // FIX as .channels()
-		{
-			m_gaussian[i].mu[ch] = 0;
-			m_gaussian[i].var[ch] = 0;
-		}
-	}
+	// only pixels inside the region of interest are modelled
+	m_spans = m_params.Roi().Spans(m_params.Width(), m_params.Height());
+	unsigned int num_pixels = SpanPixels(m_spans);
+
+	// Gaussian for each pixel
+	m_gaussian = m_gaussian_arena.Create("WrenGA.gaussian", 1, num_pixels, CV_32FC(m_params.Channels() + 1));
+	m_gaussian.setTo(cv::Scalar::all(0));
+
+	m_background.create(m_params.Height(), m_params.Width(), m_params.Type());
+	m_background.setTo(cv::Scalar::all(BACKGROUND));
+	m_background_dirty = false;
+	m_exposed.clear();
+}
+
+void WrenGA::InitModel(const BaseImage& data)
+{
+	CV_Assert(data.type() == m_params.Type());
+	DispatchPixelType(data.type(), [&](auto pixel) { InitModelImpl<decltype(pixel)>(data, m_spans); });
+	m_exposed.clear();
+	m_background_dirty = true;
+}
+
+bool WrenGA::WarpModel(const cv::Mat& transform)
+{
+	// nothing to move before Initalize()
+	if(m_spans.empty())
+		return true;
 
-	//m_background = cvCreateImage(cvSize(m_params.Width(), m_params.Height()), IPL_DEPTH_8U, 3);
-    m_background.create( m_params.Width(), m_params.Height() );
+	std::vector<int> sources;
+	WarpSources(transform, m_spans, cv::Size(m_params.Width(), m_params.Height()), sources);
+	WarpPackedRecords(sources, m_gaussian.elemSize(), m_gaussian);
+
+	// exposed pixels are initialized by the next call to Subtract()
+	m_exposed = ExposedSpans(sources, m_spans);
+	m_background_dirty = true;
+
+	return true;
 }
 
-void WrenGA::InitModel(const RgbImage& data)
+template <typename Pixel>
+void WrenGA::InitModelImpl(const BaseImage& data, const PixelSpans& spans)
 {
-	int pos = 0;
+	GAUSSIAN<Pixel::channels>* gaussian = Gaussians<Pixel::channels>();
 
-	for(unsigned int r = 0; r < m_params.Height(); ++r)
+	for(const PixelSpan& span : spans)
 	{
-		for(unsigned int c = 0; c < m_params.Width(); ++c)
+		unsigned int r = span.row;
+		int pos = span.offset;
+		for(int c = span.begin; c < span.end; ++c)
 		{
-			for(int ch = 0; ch < 3; ++ch) //FIX as .channels()
+			for(int ch = 0; ch < Pixel::channels; ++ch)
 			{	
-				m_gaussian[pos].mu[ch] = data.at< RgbPixel >(r,c)[ch];
-				m_gaussian[pos].var[ch] = m_variance;
+				gaussian[pos].mu[ch] = data.at< Pixel >(r,c)[ch];
 			}
+			gaussian[pos].var = m_variance;
 
 			pos++;
 		}
 	}
 }
 
-void WrenGA::Update(int frame_num, const RgbImage& data,  const BwImage& update_mask)
+void WrenGA::Update(int frame_num, const BaseImage& data,  const BwImage& update_mask)
+{
+	DispatchPixelType(data.type(), [&](auto pixel) { UpdateImpl<decltype(pixel)>(frame_num, data, update_mask); });
+}
+
+template <typename Pixel>
+void WrenGA::UpdateImpl(int frame_num, const BaseImage& data,  const BwImage& update_mask)
 {
-	int pos = 0;
+	GAUSSIAN<Pixel::channels>* gaussian = Gaussians<Pixel::channels>();
+	const float alpha = FrameAlpha(m_params.Alpha());
 
-	for(unsigned int r = 0; r < m_params.Height(); ++r)
+	for(const PixelSpan& span : m_spans)
 	{
-		for(unsigned int c = 0; c < m_params.Width(); ++c)
+		unsigned int r = span.row;
+		int pos = span.offset;
+		for(int c = span.begin; c < span.end; ++c)
 		{
+			if(!IsProcessed(r,c))
+			{
+				pos++;
+				continue;
+			}
+
 			// perform conditional updating only if we are passed the learning phase
 			if(update_mask.at< uchar >(r,c) == BACKGROUND || frame_num < m_params.LearningFrames())
 			{
-				float dR = m_gaussian[pos].mu[0] - data.at< RgbPixel >(r,c)[0];
-				float dG = m_gaussian[pos].mu[1] - data.at< RgbPixel >(r,c)[1];
-				float dB = m_gaussian[pos].mu[2] - data.at< RgbPixel >(r,c)[2];
-
-				float dist = (dR*dR + dG*dG + dB*dB);
+				const Pixel& pixel = data.at< Pixel >(r,c);
 
-				m_gaussian[pos].mu[0] -= m_params.Alpha()*(dR);
-				m_gaussian[pos].mu[1] -= m_params.Alpha()*(dG);
-				m_gaussian[pos].mu[2] -= m_params.Alpha()*(dB);
+				float delta[Pixel::channels];
+				float dist = 0;
+				for(int ch = 0; ch < Pixel::channels; ++ch)
+				{
+					delta[ch] = gaussian[pos].mu[ch] - pixel[ch];
+					dist += delta[ch]*delta[ch];
+				}
 
-				float sigmanew = m_gaussian[pos].var[0] + m_params.Alpha()*(dist-m_gaussian[pos].var[0]);
-				m_gaussian[pos].var[0] = sigmanew < 4 ? 4 : sigmanew > 5*m_variance ? 5*m_variance : sigmanew;
+				for(int ch = 0; ch < Pixel::channels; ++ch)
+				{
+					gaussian[pos].mu[ch] -= alpha*(delta[ch]);
+				}
 
-				m_background.at< RgbPixel >(r, c)[0] = (unsigned char)(m_gaussian[pos].mu[0] + 0.5);
-				m_background.at< RgbPixel >(r, c)[1] = (unsigned char)(m_gaussian[pos].mu[1] + 0.5);
-				m_background.at< RgbPixel >(r, c)[2] = (unsigned char)(m_gaussian[pos].mu[2] + 0.5);
+				float sigmanew = gaussian[pos].var + alpha*(dist-gaussian[pos].var);
+				gaussian[pos].var = sigmanew < 4 ? 4 : sigmanew > 5*m_variance ? 5*m_variance : sigmanew;
 			}
 
 			pos++;
 		}
 	}
+
+	m_background_dirty = true;
+}
+
+void WrenGA::UpdateBackground() const
+{
+	if(!m_background_dirty)
+		return;
+
+	DispatchPixelType(m_params.Type(), [&](auto pixel) { UpdateBackgroundImpl<decltype(pixel)>(); });
+	m_background_dirty = false;
+}
+
+template <typename Pixel>
+void WrenGA::UpdateBackgroundImpl() const
+{
+	const GAUSSIAN<Pixel::channels>* gaussian = m_gaussian.ptr< GAUSSIAN<Pixel::channels> >();
+
+	for(const PixelSpan& span : m_spans)
+	{
+		Pixel* background = m_background.ptr< Pixel >(span.row);
+		unsigned int pixel = span.offset;
+		for(int c = span.begin; c < span.end; ++c, ++pixel)
+		{
+			for(int ch = 0; ch < Pixel::channels; ++ch)
+			{
+				background[c][ch] = RoundChannel< typename Pixel::value_type >(gaussian[pixel].mu[ch]);
+			}
+		}
+	}
 }
 
-void WrenGA::SubtractPixel(int r, int c, const RgbPixel& pixel, 
+template <typename Pixel>
+void WrenGA::SubtractPixel(unsigned int pos, const Pixel& pixel, 
 															unsigned char& low_threshold, 
 															unsigned char& high_threshold)
 {
-	unsigned int pos = r*m_params.Width()+c;
+	const GAUSSIAN<Pixel::channels>& gaussian = Gaussians<Pixel::channels>()[pos];
 
 	// calculate distance between model and pixel
-	float mu[3];//FIX as .channels()
-	float var[1];
-	float delta[3];//FIX as .channels()
 	float dist = 0;
-	for(int ch = 0; ch < 3; ++ch)//FIX as .channels()
+	for(int ch = 0; ch < Pixel::channels; ++ch)
 	{
-		mu[ch] = m_gaussian[pos].mu[ch];
-		var[0] = m_gaussian[pos].var[0];
-		delta[ch] = mu[ch] - pixel(ch);
-		dist += delta[ch]*delta[ch];
+		float delta = gaussian.mu[ch] - pixel(ch);
+		dist += delta*delta;
 	}
 
 	// calculate the squared distance and see if pixel fits the B/G model
 	low_threshold = BACKGROUND;
 	high_threshold = BACKGROUND;
 
-	if(dist > m_params.LowThreshold()*var[0])
+	if(dist > m_params.LowThreshold()*gaussian.var)
 		low_threshold = FOREGROUND;
-	if(dist > m_params.HighThreshold()*var[0])
+	if(dist > m_params.HighThreshold()*gaussian.var)
 		high_threshold = FOREGROUND;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 //Input:
-//  data - a pointer to the data of a RGB image of the same size
+//  data - a pointer to the data of a RGB or grayscale image of the same size
 //Output:
 //  output - a pointer to the data of a gray value image of the same size 
 //					(the memory should already be reserved) 
 //					values: 255-foreground, 125-shadow, 0-background
 ///////////////////////////////////////////////////////////////////////////////
-void WrenGA::Subtract(int frame_num, const RgbImage& data, 
+void WrenGA::Subtract(int frame_num, const BaseImage& data, 
 												BwImage& low_threshold_mask, BwImage& high_threshold_mask)
+{
+	CV_Assert(data.type() == m_params.Type());
+
+	// pixels outside of the region of interest are background (masks passed to a call
+	// restricted by a process mask already hold the previous, cleared, values)
+	if(!m_params.Roi().Empty() && m_process_mask.empty())
+	{
+		low_threshold_mask.setTo(BACKGROUND);
+		high_threshold_mask.setTo(BACKGROUND);
+	}
+
+	if(!m_exposed.empty())
+	{
+		DispatchPixelType(data.type(), [&](auto pixel) { InitModelImpl<decltype(pixel)>(data, m_exposed); });
+		m_exposed.clear();
+	}
+
+	DispatchPixelType(data.type(), [&](auto pixel) { SubtractImpl<decltype(pixel)>(data, low_threshold_mask, high_threshold_mask); });
+}
+
+template <typename Pixel>
+void WrenGA::SubtractImpl(const BaseImage& data, BwImage& low_threshold_mask, BwImage& high_threshold_mask)
 {
 	unsigned char low_threshold, high_threshold;
 
 	// update each pixel of the image
-	for(unsigned int r = 0; r < m_params.Height(); ++r)
+	for(const PixelSpan& span : m_spans)
 	{
-		for(unsigned int c = 0; c < m_params.Width(); ++c)
+		unsigned int r = span.row;
+		unsigned int pos = span.offset;
+		for(int c = span.begin; c < span.end; ++c, ++pos)
 		{
-			SubtractPixel(r, c, data.at< RgbPixel >(r,c), low_threshold, high_threshold);
+			if(!IsProcessed(r,c))
+				continue;
+
+			SubtractPixel(pos, data.at< Pixel >(r,c), low_threshold, high_threshold);
 			low_threshold_mask.at< uchar >(r,c) = low_threshold;
 			high_threshold_mask.at< uchar >(r,c) = high_threshold;
 		}
 	}
 }
-
@@ -77,10 +77,12 @@ private:
 class WrenGA : public Bgs
 {
 private:	
+	// mean and (isotropic) variance of a pixel with CN channels
+	template <int CN>
 	struct GAUSSIAN
 	{
-		float mu[ 3 ];
-		float var[ 3 ];
+		float mu[ CN ];
+		float var;
 	};
 
 public:
@@ -89,26 +91,49 @@ public:
 
 	void Initalize(const BgsParams& param);
 
-	void InitModel(const RgbImage& data);
-	void Subtract(int frame_num, const RgbImage& data,  
+	void InitModel(const BaseImage& data);
+	bool WarpModel(const cv::Mat& transform);
+	void Subtract(int frame_num, const BaseImage& data,  
 									BwImage& low_threshold_mask, BwImage& high_threshold_mask);	
-	void Update(int frame_num, const RgbImage& data,  const BwImage& update_mask);
+	void Update(int frame_num, const BaseImage& data,  const BwImage& update_mask);
 
-	RgbImage Background() { return m_background; }
+	BaseImage Background() { UpdateBackground(); return m_background; }
+	void getBackgroundImage(cv::OutputArray backgroundImage) const { UpdateBackground(); m_background.copyTo(backgroundImage); }
 
 private:	
-	void SubtractPixel(int r, int c, const RgbPixel& pixel, 
-											unsigned char& lowThreshold, unsigned char& highThreshold);
+	// per-pixel code for pixels of type Pixel (cv::Vec< T, channels > of uchar, ushort or float)
+	template <typename Pixel> void InitModelImpl(const BaseImage& data, const PixelSpans& spans);
+	template <typename Pixel> void SubtractImpl(const BaseImage& data, 
+																							BwImage& low_threshold_mask, BwImage& high_threshold_mask);
+	template <typename Pixel> void UpdateImpl(int frame_num, const BaseImage& data, const BwImage& update_mask);
+
+	// Compute m_background from the model if the model changed since it was last computed
+	void UpdateBackground() const;
+	template <typename Pixel> void UpdateBackgroundImpl() const;
+
+	template <typename Pixel> void SubtractPixel(unsigned int pos, const Pixel& pixel, 
+																							unsigned char& lowThreshold, unsigned char& highThreshold);
+
+	template <int CN> GAUSSIAN<CN>* Gaussians() { return m_gaussian.ptr< GAUSSIAN<CN> >(); }
 
 	WrenParams m_params;
 
+	// Runs of pixels inside the region of interest. Model arrays only hold these pixels.
+	PixelSpans m_spans;
+
 	// Initial variance for the newly generated components. 
 	float m_variance;
 
-	// dynamic array for the mixture of Gaussians
-	GAUSSIAN* m_gaussian;
+	// Gaussian of each pixel, stored as GAUSSIAN<channels> (channels+1 floats per pixel)
+	ModelArena m_gaussian_arena;
+	BaseImage m_gaussian;
+
+	// Pixels exposed by the last WarpModel(), initialized from the next frame
+	PixelSpans m_exposed;
 
-	RgbImage m_background;
+	// Mean of the gaussian of each pixel, computed on request from the model
+	mutable BaseImage m_background;
+	mutable bool m_background_dirty;
 };
 
 };
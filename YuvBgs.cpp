@@ -0,0 +1,212 @@
+/****************************************************************************
+*
+*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+******************************************************************************/
+
+#include "YuvBgs.hpp"
+
+using namespace Algorithms::BackgroundSubtraction;
+
+namespace
+{
+    // Set the pixels of mask whose 2x2 block is set in the chroma mask. Pixels outside of
+    // the process mask are left untouched.
+    void    CombineChromaMask( const BwImage& chroma, BwImage& mask, const BwImage& process_mask )
+    {
+        for( int r = 0; r < mask.rows; ++r )
+        {
+            const uchar* src = chroma.ptr< uchar >( r / 2 );
+            const uchar* process = process_mask.empty() ? NULL : process_mask.ptr< uchar >( r );
+            uchar* dst = mask.ptr< uchar >( r );
+
+            for( int c = 0; c < mask.cols; ++c )
+            {
+                if( process == NULL || process[ c ] != 0 )
+                {
+                    dst[ c ] |= src[ c / 2 ];
+                }
+            }
+        }
+    }
+}
+
+YuvBgs::YuvBgs( const cv::Ptr< Bgs >& luma, const cv::Ptr< Bgs >& chroma, YuvLayout layout ) :
+    m_luma( luma ),
+    m_chroma( chroma ),
+    m_layout( layout )
+{
+    CV_Assert( !m_luma.empty() );
+}
+
+cv::Size    YuvBgs::ChromaSize( cv::Size size )
+{
+    return cv::Size( size.width / 2, size.height / 2 );
+}
+
+void    YuvBgs::Initalize( const BgsParams& param )
+{
+    CV_Assert( param.Width() % 2 == 0 && param.Height() % 2 == 0 );
+
+    m_size = cv::Size( param.Width(), param.Height() );
+    m_chroma_size = ChromaSize( m_size );
+
+    m_chroma_low_threshold_mask.create( m_chroma_size );
+    m_chroma_low_threshold_mask.setTo( BACKGROUND );
+    m_chroma_high_threshold_mask.create( m_chroma_size );
+    m_chroma_high_threshold_mask.setTo( BACKGROUND );
+}
+
+void    YuvBgs::SplitPlanes( const BaseImage& data )
+{
+    CV_Assert( data.channels() == 1 && data.cols == m_size.width && data.rows == m_size.height * 3 / 2 );
+
+    const int height = m_size.height;
+    m_luma_plane = data.rowRange( 0, height );
+
+    if( m_chroma.empty() )
+        return;
+
+    if( m_layout == YUV_NV12 )
+    {
+        // rows of interleaved UV samples
+        m_chroma_plane = data.rowRange( height, height + height / 2 ).reshape( 2 );
+    }
+    else
+    {
+        // each plane is a quarter of the luma plane packed after it, so a plane does not
+        // start on a buffer row unless the height is a multiple of 4
+        CV_Assert( data.isContinuous() );
+        // the planes are only read by cv::merge
+        uchar* u = const_cast< uchar* >( data.ptr( height ) );
+        uchar* v = u + m_chroma_size.area() * data.elemSize();
+        m_chroma_planes[ 0 ] = BaseImage( m_chroma_size, data.type(), u );
+        m_chroma_planes[ 1 ] = BaseImage( m_chroma_size, data.type(), v );
+        cv::merge( m_chroma_planes, 2, m_chroma_plane );
+    }
+}
+
+void    YuvBgs::InitModel( const BaseImage& data )
+{
+    SplitPlanes( data );
+
+    m_luma->InitModel( m_luma_plane );
+    if( !m_chroma.empty() )
+    {
+        m_chroma->InitModel( m_chroma_plane );
+    }
+}
+
+bool    YuvBgs::WarpModel( const cv::Mat& transform )
+{
+    bool warped = m_luma->WarpModel( transform );
+
+    // chroma is subsampled by 2 in both directions
+    if( !m_chroma.empty() )
+    {
+        warped = m_chroma->WarpModel( ScaledTransform( transform, 0.5, 0.5 ) ) && warped;
+    }
+
+    // both planes start over if either can not follow the motion
+    if( !warped )
+    {
+        m_frame_num = 0;
+    }
+    return warped;
+}
+
+bool    YuvBgs::NeedsFullFrame( int frame_num ) const
+{
+    return m_luma->NeedsFullFrame( frame_num ) || ( !m_chroma.empty() && m_chroma->NeedsFullFrame( frame_num ) );
+}
+
+void    YuvBgs::Subtract( int frame_num, const BaseImage& data,
+                          BwImage& low_threshold_mask, BwImage& high_threshold_mask )
+{
+    SplitPlanes( data );
+
+    m_luma->SetLearningRate( m_learning_rate );
+    m_luma->SetProcessMask( m_process_mask );
+    m_luma->Subtract( frame_num, m_luma_plane, low_threshold_mask, high_threshold_mask );
+
+    if( m_chroma.empty() )
+        return;
+
+    m_chroma->SetLearningRate( m_learning_rate );
+    if( m_process_mask.empty() )
+    {
+        m_chroma->SetProcessMask( BwImage() );
+    }
+    else
+    {
+        ReduceMask( m_process_mask, m_chroma_process_mask, m_chroma_size );
+        m_chroma->SetProcessMask( m_chroma_process_mask );
+    }
+
+    m_chroma->Subtract( frame_num, m_chroma_plane, m_chroma_low_threshold_mask, m_chroma_high_threshold_mask );
+
+    CombineChromaMask( m_chroma_low_threshold_mask, low_threshold_mask, m_process_mask );
+    CombineChromaMask( m_chroma_high_threshold_mask, high_threshold_mask, m_process_mask );
+}
+
+void    YuvBgs::Update( int frame_num, const BaseImage& data, const BwImage& update_mask )
+{
+    // the planes of the frame passed to the last call to Subtract() are reused and a chroma
+    // sample is only updated if all pixels of its block are background
+    m_luma->Update( frame_num, m_luma_plane, update_mask );
+
+    if( !m_chroma.empty() )
+    {
+        ReduceMask( update_mask, m_chroma_update_mask, m_chroma_size );
+        m_chroma->Update( frame_num, m_chroma_plane, m_chroma_update_mask );
+    }
+}
+
+void    YuvBgs::getBackgroundImage( cv::OutputArray backgroundImage ) const
+{
+    const int height = m_size.height;
+
+    BaseImage luma;
+    m_luma->getBackgroundImage( luma );
+
+    BaseImage background( height * 3 / 2, m_size.width, luma.type() );
+    luma.copyTo( background.rowRange( 0, height ) );
+
+    if( m_chroma.empty() )
+    {
+        double neutral = luma.depth() == CV_8U ? 128 : luma.depth() == CV_16U ? 32768 : 0.5;
+        background.rowRange( height, background.rows ).setTo( cv::Scalar::all( neutral ) );
+    }
+    else
+    {
+        BaseImage chroma;
+        m_chroma->getBackgroundImage( chroma );
+
+        if( m_layout == YUV_NV12 )
+        {
+            BaseImage uv = background.rowRange( height, background.rows ).reshape( 2 );
+            chroma.copyTo( uv );
+        }
+        else
+        {
+            BaseImage planes[ 2 ] = {
+                background.rowRange( height, height + height / 4 ).reshape( 1, m_chroma_size.height ),
+                background.rowRange( height + height / 4, background.rows ).reshape( 1, m_chroma_size.height )
+            };
+            cv::split( chroma, planes );
+        }
+    }
+
+    background.copyTo( backgroundImage );
+}
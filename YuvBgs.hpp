@@ -0,0 +1,129 @@
+/****************************************************************************
+*
+*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+******************************************************************************/
+
+/****************************************************************************
+*
+* YuvBgs.hpp
+*
+* Purpose: Background subtraction of planar 4:2:0 YUV frames (NV12 or I420) as
+*          emitted by video decoders, without a conversion to RGB. Luma is
+*          modelled at full resolution and chroma at the subsampled resolution
+*          of the frames by two algorithms of any kind. A pixel is foreground
+*          if its luma or the chroma of its 2x2 block is foreground.
+*
+*          Frames are single channel buffers of height * 3 / 2 rows: the luma
+*          plane followed by the interleaved UV plane (NV12) or the U and V
+*          planes (I420). The luma and NV12 chroma planes are passed to the
+*          algorithms without copying them.
+
+Example:
+    // luma at full resolution
+    Algorithms::BackgroundSubtraction::GrimsonParams lumaParams;
+    lumaParams.SetFrameSize( width, height );
+    lumaParams.Channels() = 1;
+    ...
+    cv::Ptr< Algorithms::BackgroundSubtraction::Bgs > luma( new Algorithms::BackgroundSubtraction::GrimsonGMM() );
+    luma->Initalize( lumaParams );
+
+    // interleaved chroma at half resolution
+    cv::Size chromaSize = Algorithms::BackgroundSubtraction::YuvBgs::ChromaSize( cv::Size( width, height ) );
+    Algorithms::BackgroundSubtraction::GrimsonParams chromaParams;
+    chromaParams.SetFrameSize( chromaSize.width, chromaSize.height );
+    chromaParams.Channels() = 2;
+    ...
+    cv::Ptr< Algorithms::BackgroundSubtraction::Bgs > chroma( new Algorithms::BackgroundSubtraction::GrimsonGMM() );
+    chroma->Initalize( chromaParams );
+
+    Algorithms::BackgroundSubtraction::YuvBgs bgs( luma, chroma, Algorithms::BackgroundSubtraction::YUV_NV12 );
+    bgs.Initalize( params );    // params.SetFrameSize( width, height )
+
+    cv::Mat nv12;               // height * 3 / 2 rows of width bytes
+    cv::Mat fgmask;             // height rows of width bytes
+    bgs.apply( nv12, fgmask );
+******************************************************************************/
+
+#ifndef _YUV_BGS_H_
+#define _YUV_BGS_H_
+
+#include "Bgs.hpp"
+
+namespace Algorithms
+{
+    namespace BackgroundSubtraction
+    {
+
+        // --- Plane layouts of 4:2:0 frames ---
+        enum YuvLayout
+        {
+            YUV_NV12,   // Y plane, interleaved UV plane
+            YUV_I420    // Y plane, U plane, V plane
+        };
+
+        // --- BGS of planar YUV frames ---
+        class YuvBgs : public Bgs
+        {
+        public:
+            // luma    - algorithm initialized for the frame size with one channel
+            // chroma  - algorithm initialized for ChromaSize() with two channels, or
+            //           empty to classify the frames by luma only
+            // layout  - plane layout of the frames
+            YuvBgs( const cv::Ptr< Bgs >& luma, const cv::Ptr< Bgs >& chroma, YuvLayout layout );
+
+            // Size of the chroma planes of frames of the given size.
+            static cv::Size ChromaSize( cv::Size size );
+
+            // param holds the size of the image (not of the frame buffer).
+            void    Initalize( const BgsParams& param );
+
+            void    InitModel( const BaseImage& data );
+            bool    WarpModel( const cv::Mat& transform );
+            bool    NeedsFullFrame( int frame_num ) const;
+            void    Subtract( int frame_num, const BaseImage& data,
+                              BwImage& low_threshold_mask, BwImage& high_threshold_mask );
+            void    Update( int frame_num, const BaseImage& data, const BwImage& update_mask );
+
+            // Background in the layout of the frames. Chroma is neutral without a chroma model.
+            void    getBackgroundImage( cv::OutputArray backgroundImage ) const;
+
+        protected:
+            cv::Size    MaskSize( const BaseImage& data ) const { return m_size; }
+
+        private:
+            // Point m_luma_plane and m_chroma_plane to the planes of the frame.
+            void    SplitPlanes( const BaseImage& data );
+
+            cv::Ptr< Bgs >  m_luma;
+            cv::Ptr< Bgs >  m_chroma;
+            YuvLayout       m_layout;
+
+            cv::Size        m_size;
+            cv::Size        m_chroma_size;
+
+            BaseImage       m_luma_plane;       // view of the luma plane of the last frame
+            BaseImage       m_chroma_plane;     // view (NV12) or interleaved copy (I420) of the chroma planes
+            BaseImage       m_chroma_planes[ 2 ];
+
+            BwImage         m_chroma_low_threshold_mask;
+            BwImage         m_chroma_high_threshold_mask;
+            BwImage         m_chroma_process_mask;
+            BwImage         m_chroma_update_mask;
+        };
+
+    };
+};
+
+#endif
@@ -41,68 +41,122 @@
 * Zivkovic's code can be obtained at: www.zoranz.net
 ******************************************************************************/
 
+#include <algorithm>
+#include <cfloat>
+#include <cstring>
+
 #include "ZivkovicAGMM.hpp"
 
 using namespace Algorithms::BackgroundSubtraction;
 
 ZivkovicAGMM::ZivkovicAGMM()
 {
-	m_modes = NULL;
 	m_modes_per_pixel = NULL;
 }
 
 ZivkovicAGMM::~ZivkovicAGMM()
 {
-	if(m_modes != NULL)
-		delete[] m_modes;
-
-	if(m_modes_per_pixel != NULL)
-		delete[] m_modes_per_pixel;
 }
 
 void ZivkovicAGMM::Initalize(const BgsParams& param)
 {
-	m_params = (ZivkovicParams&)param;
+	m_params = dynamic_cast<const ZivkovicParams&>(param);
 
-	m_num_bands = 3;							//always 3 - not implemented for other values!
+	m_num_bands = m_params.Channels();
 	m_bg_threshold = 0.75f;				//1-cf from the paper 
 	m_variance = 36.0f;						// variance for the new mode
+	m_alpha = m_params.Alpha();
 	m_complexity_prior = 0.05f;		// complexity reduction prior constant
 
+	// only pixels inside the region of interest are modelled
+	m_spans = m_params.Roi().Spans(m_params.Width(), m_params.Height());
+	unsigned int num_pixels = SpanPixels(m_spans);
+
 	// GMM for each pixel
-	m_modes = new GMM[m_params.Size()*m_params.MaxModes()];
+	m_modes = m_modes_arena.Create("ZivkovicAGMM.modes", 1, num_pixels*m_params.MaxModes(), CV_32FC(m_num_bands + 2));
 
 	// used modes per pixel
-	m_modes_per_pixel = new unsigned char[m_params.Size()];
+	m_modes_per_pixel = m_modes_per_pixel_arena.Create("ZivkovicAGMM.modes_per_pixel", 1, num_pixels, CV_8U).ptr<unsigned char>();
 
-    m_background.create( m_params.Width(), m_params.Height() );
+	// decay not yet applied to the weights of each pixel
+	m_decay = m_decay_arena.Create("ZivkovicAGMM.decay", 1, num_pixels, CV_32F).ptr<float>();
+	std::fill(m_decay, m_decay + num_pixels, 1.0f);
+
+	m_background.create(m_params.Height(), m_params.Width(), m_params.Type());
+	m_background.setTo(cv::Scalar::all(BACKGROUND));
+	m_background_dirty = false;
 }
 
-void ZivkovicAGMM::InitModel(const RgbImage& data)
+void ZivkovicAGMM::InitModel(const BaseImage& data)
 {
-	for(unsigned int i = 0; i < m_params.Size(); ++i)
+	unsigned int num_pixels = SpanPixels(m_spans);
+	for(unsigned int i = 0; i < num_pixels; ++i)
 	{
 		m_modes_per_pixel[i] = 0;
 	}
 
-	for(unsigned int i = 0; i < m_params.Size()*m_params.MaxModes(); ++i)
+	m_modes.setTo(cv::Scalar::all(0));
+	std::fill(m_decay, m_decay + SpanPixels(m_spans), 1.0f);
+	m_background_dirty = true;
+}
+
+bool ZivkovicAGMM::WarpModel(const cv::Mat& transform)
+{
+	// nothing to move before Initalize()
+	if(m_spans.empty())
+		return true;
+
+	std::vector<int> sources;
+	WarpSources(transform, m_spans, cv::Size(m_params.Width(), m_params.Height()), sources);
+
+	// the modes of a pixel move together with their count
+	cv::Mat modes_per_pixel(1, (int)sources.size(), CV_8U, m_modes_per_pixel);
+	cv::Mat decay(1, (int)sources.size(), CV_32F, m_decay);
+	WarpPackedRecords(sources, m_params.MaxModes()*m_modes.elemSize(), m_modes);
+	WarpPackedRecords(sources, 1, modes_per_pixel);
+	WarpPackedRecords(sources, sizeof(float), decay);
+
+	// exposed pixels have no mode, so the next frame creates one as it does after InitModel()
+	for(const PixelSpan& span : ExposedSpans(sources, m_spans))
 	{
-		m_modes[i].weight = 0;
-		m_modes[i].sigma = 0;
-		m_modes[i].muR = 0;
-		m_modes[i].muG = 0;
-		m_modes[i].muB = 0;
+		memset(m_modes_per_pixel + span.offset, 0, span.end - span.begin);
+		std::fill(m_decay + span.offset, m_decay + span.offset + span.end - span.begin, 1.0f);
 	}
+
+	m_background_dirty = true;
+
+	return true;
 }
 
-void ZivkovicAGMM::Update(int frame_num, const RgbImage& data,  const BwImage& update_mask)
+void ZivkovicAGMM::Update(int frame_num, const BaseImage& data,  const BwImage& update_mask)
 {
 	// it doesn't make sense to have conditional updates in the GMM framework
 }
 
-void ZivkovicAGMM::SubtractPixel(long posPixel, const RgbPixel& pixel, unsigned char* pModesUsed, 
-																	unsigned char& low_threshold, unsigned char& high_threshold)
+template <typename Pixel>
+void ZivkovicAGMM::SubtractPixel(long posPixel, const Pixel& pixel, unsigned char* pModesUsed, 
+																	unsigned char& low_threshold, unsigned char& high_threshold,
+																	GmmModeCounts* counts)
 {
+	typedef GMM<Pixel::channels> Mode;
+	Mode* modes = Modes<Pixel::channels>();
+
+	if(m_params.LazyDecay())
+	{
+		float& decay = m_decay[posPixel/m_params.MaxModes()];
+		if(SubtractStablePixel(posPixel, pixel, *pModesUsed, decay))
+		{
+			low_threshold = BACKGROUND;
+			high_threshold = BACKGROUND;
+			if(counts)
+				counts->matched++;
+			return;
+		}
+
+		// the exact update works on up to date weights
+		ApplyDecay<Pixel::channels>(posPixel, *pModesUsed, decay);
+	}
+
 	//calculate distances to the modes (+ sort???)
 	//here we need to go in descending order!!!
 	long pos;
@@ -110,9 +164,9 @@ void ZivkovicAGMM::SubtractPixel(long posPixel, const RgbPixel& pixel, unsigned
 	bool bBackgroundLow=false;
 	bool bBackgroundHigh=false;
 
-	float fOneMinAlpha = 1-m_params.Alpha();
+	float fOneMinAlpha = 1-m_alpha;
 
-	float prune = -m_params.Alpha()*m_complexity_prior;
+	float prune = -m_alpha*m_complexity_prior;
 
 	int nModes =* pModesUsed;
 	float totalWeight = 0.0f;
@@ -125,7 +179,7 @@ void ZivkovicAGMM::SubtractPixel(long posPixel, const RgbPixel& pixel, unsigned
 		if(sum < m_bg_threshold)
 		{
 			backgroundGaussians++;
-			sum += m_modes[posPixel+i].weight;
+			sum += modes[posPixel+i].weight;
 		}
 		else
 		{
@@ -137,24 +191,23 @@ void ZivkovicAGMM::SubtractPixel(long posPixel, const RgbPixel& pixel, unsigned
 	for (int iModes = 0; iModes < nModes; iModes++)
 	{
 		pos=posPixel+iModes;
-		float weight = m_modes[pos].weight;
+		float weight = modes[pos].weight;
 
 		//fit not found yet
 		if (!bFitsPDF)
 		{
 			//check if it belongs to some of the modes
 			//calculate distance
-			float var = m_modes[pos].sigma;
-			float muR = m_modes[pos].muR;
-			float muG = m_modes[pos].muG;
-			float muB = m_modes[pos].muB;
-		
-			float dR=muR - pixel(0);
-			float dG=muG - pixel(1);
-			float dB=muB - pixel(2);
-			
+			float var = modes[pos].sigma;
+
 			// calculate the squared distance
-			float dist = (dR*dR + dG*dG + dB*dB);
+			float delta[Pixel::channels];
+			float dist = 0;
+			for(int ch = 0; ch < Pixel::channels; ++ch)
+			{
+				delta[ch] = modes[pos].mu[ch] - pixel(ch);
+				dist += delta[ch]*delta[ch];
+			}
 
 			if(dist < m_params.HighThreshold()*var && iModes < backgroundGaussians)
 				bBackgroundHigh = true;
@@ -165,19 +218,22 @@ void ZivkovicAGMM::SubtractPixel(long posPixel, const RgbPixel& pixel, unsigned
 				/////
 				//belongs to the mode
 				bFitsPDF = true;
+				if(counts)
+					counts->matched++;
 
 				// check if this Gaussian is part of the background model
 				if(iModes < backgroundGaussians) 
 					bBackgroundLow = true;
 
 				//update distribution
-				float k = m_params.Alpha()/weight;
+				float k = m_alpha/weight;
 				weight = fOneMinAlpha*weight+prune;
-				weight += m_params.Alpha();
-				m_modes[pos].weight = weight;
-				m_modes[pos].muR = muR - k*(dR);
-				m_modes[pos].muG = muG - k*(dG);
-				m_modes[pos].muB = muB - k*(dB);
+				weight += m_alpha;
+				modes[pos].weight = weight;
+				for(int ch = 0; ch < Pixel::channels; ++ch)
+				{
+					modes[pos].mu[ch] -= k*delta[ch];
+				}
 
 				//limit update speed for cov matrice
 				//not needed
@@ -188,7 +244,7 @@ void ZivkovicAGMM::SubtractPixel(long posPixel, const RgbPixel& pixel, unsigned
 				float sigmanew = var + k*(dist-var);
 
 				//limit the variance
-				m_modes[pos].sigma = sigmanew < 4 ? 4 : sigmanew > 5*m_variance ? 5*m_variance : sigmanew;
+				modes[pos].sigma = sigmanew < 4 ? 4 : sigmanew > 5*m_variance ? 5*m_variance : sigmanew;
 
 				// Sort weights so they are in desending order. Note that only the weight for this
 				// mode will increase and that the weight for all modes that were previously larger than
@@ -200,16 +256,16 @@ void ZivkovicAGMM::SubtractPixel(long posPixel, const RgbPixel& pixel, unsigned
 				for (int iLocal = iModes;iLocal>0;iLocal--)
 				{
 					long posLocal=posPixel + iLocal;
-					if (weight < (m_modes[posLocal-1].weight))
+					if (weight < (modes[posLocal-1].weight))
 					{
 						break;
 					}
 					else
 					{
 						//swap
-						GMM temp = m_modes[posLocal];
-						m_modes[posLocal] = m_modes[posLocal-1];
-						m_modes[posLocal-1] = temp;
+						Mode temp = modes[posLocal];
+						modes[posLocal] = modes[posLocal-1];
+						modes[posLocal-1] = temp;
 					}
 				}
 				*/
@@ -217,12 +273,12 @@ void ZivkovicAGMM::SubtractPixel(long posPixel, const RgbPixel& pixel, unsigned
 				for (int iLocal = iModes; iLocal > 0; iLocal--)
 				{
 					long posLocal = posPixel + iLocal;
-					if (m_modes[posLocal].weight > m_modes[posLocal-1].weight)
+					if (modes[posLocal].weight > modes[posLocal-1].weight)
 					{
 						//swap
-						GMM temp = m_modes[posLocal];
-						m_modes[posLocal] = m_modes[posLocal-1];
-						m_modes[posLocal-1] = temp;
+						Mode temp = modes[posLocal];
+						modes[posLocal] = modes[posLocal-1];
+						modes[posLocal-1] = temp;
 					}
 					else
 					{
@@ -238,8 +294,10 @@ void ZivkovicAGMM::SubtractPixel(long posPixel, const RgbPixel& pixel, unsigned
 				{
 					weight=0.0;
 					nModes--;
+					if(counts)
+						counts->pruned++;
 				}
-				m_modes[pos].weight = weight;
+				modes[pos].weight = weight;
 			}
 			//check if it fits the current mode (2.5 sigma)
 			///////
@@ -254,8 +312,10 @@ void ZivkovicAGMM::SubtractPixel(long posPixel, const RgbPixel& pixel, unsigned
 			{
 				weight=0.0;
 				nModes--;
+				if(counts)
+					counts->pruned++;
 			}
-			m_modes[pos].weight = weight;
+			modes[pos].weight = weight;
 		}
 		totalWeight += weight;
 	}
@@ -263,8 +323,14 @@ void ZivkovicAGMM::SubtractPixel(long posPixel, const RgbPixel& pixel, unsigned
 	//renormalize weights so they sum to 1
 	for (int iLocal = 0; iLocal < nModes; iLocal++)
 	{
-		m_modes[posPixel+ iLocal].weight = m_modes[posPixel+ iLocal].weight/totalWeight;
+		modes[posPixel+ iLocal].weight = modes[posPixel+ iLocal].weight/totalWeight;
 	}
+
+	// shadow test of foreground pixels before an unmatched pixel gets a mode of its own, which
+	// would otherwise be a perfect fit of an unscaled shadow
+	float shadowDist = FLT_MAX;
+	if(m_params.ShadowDetection() && !(bBackgroundLow && bBackgroundHigh))
+		shadowDist = ShadowDistance(posPixel, nModes, pixel);
 	
 	//make new mode if needed and exit
 	if (!bFitsPDF)
@@ -272,17 +338,21 @@ void ZivkovicAGMM::SubtractPixel(long posPixel, const RgbPixel& pixel, unsigned
 		if (nModes == m_params.MaxModes())
 		{
 			//replace the weakest
+			if(counts)
+				counts->replaced++;
 		}
 		else
 		{
 			nModes++;
+			if(counts)
+				counts->added++;
 		}
 		pos = posPixel + nModes-1;
 
     if (nModes==1)
-			m_modes[pos].weight=1;
+			modes[pos].weight=1;
 		else
-			m_modes[pos].weight=m_params.Alpha();
+			modes[pos].weight=m_alpha;
 
 		// Zivkovic implementation changes as this will not result in the
 		// weights adding to 1
@@ -290,7 +360,7 @@ void ZivkovicAGMM::SubtractPixel(long posPixel, const RgbPixel& pixel, unsigned
 		int iLocal;
 		for (iLocal = 0; iLocal < m_params.MaxModes()odes-1; iLocal++)
 		{
-			m_modes[posPixel+ iLocal].weight *= fOneMinAlpha;
+			modes[posPixel+ iLocal].weight *= fOneMinAlpha;
 		}
 		*/
 
@@ -300,19 +370,20 @@ void ZivkovicAGMM::SubtractPixel(long posPixel, const RgbPixel& pixel, unsigned
 		float sum = 0.0;
 		for (iLocal = 0; iLocal < nModes; iLocal++)
 		{
-			sum += m_modes[posPixel+ iLocal].weight;
+			sum += modes[posPixel+ iLocal].weight;
 		}
 
 		float invSum = 1.0f/sum;
 		for (iLocal = 0; iLocal < nModes; iLocal++)
 		{
-			m_modes[posPixel+ iLocal].weight *= invSum;
+			modes[posPixel+ iLocal].weight *= invSum;
 		}
 
-		m_modes[pos].muR=pixel(0);
-		m_modes[pos].muG=pixel(1);
-		m_modes[pos].muB=pixel(2);
-		m_modes[pos].sigma=m_variance;
+		for(int ch = 0; ch < Pixel::channels; ++ch)
+		{
+			modes[pos].mu[ch]=pixel(ch);
+		}
+		modes[pos].sigma=m_variance;
 
 		// Zivkovic implementation to sort GMM so they are sorted in descending order according to their weight.
 		// It has been revised for clarity, but the results are equivalent
@@ -320,16 +391,16 @@ void ZivkovicAGMM::SubtractPixel(long posPixel, const RgbPixel& pixel, unsigned
 		for (iLocal = m_params.MaxModes()odes-1; iLocal > 0; iLocal--)
 		{
 			long posLocal = posPixel + iLocal;
-			if (m_params.Alpha() < (m_modes[posLocal-1].weight))
+			if (m_alpha < (modes[posLocal-1].weight))
 			{
 				break;
 			}
 			else
 			{
 				//swap
-				GMM temp = m_modes[posLocal];
-				m_modes[posLocal] = m_modes[posLocal-1];
-				m_modes[posLocal-1] = temp;
+				Mode temp = modes[posLocal];
+				modes[posLocal] = modes[posLocal-1];
+				modes[posLocal-1] = temp;
 			}
 		}
 		*/
@@ -338,12 +409,12 @@ void ZivkovicAGMM::SubtractPixel(long posPixel, const RgbPixel& pixel, unsigned
 		for (iLocal = nModes-1; iLocal > 0; iLocal--)
 		{
 			long posLocal = posPixel + iLocal;
-			if (m_modes[posLocal].weight > m_modes[posLocal-1].weight)
+			if (modes[posLocal].weight > modes[posLocal-1].weight)
 			{
 				//swap
-				GMM temp = m_modes[posLocal];
-				m_modes[posLocal] = m_modes[posLocal-1];
-				m_modes[posLocal-1] = temp;
+				Mode temp = modes[posLocal];
+				modes[posLocal] = modes[posLocal-1];
+				modes[posLocal-1] = temp;
 			}
 			else
 			{
@@ -372,6 +443,136 @@ void ZivkovicAGMM::SubtractPixel(long posPixel, const RgbPixel& pixel, unsigned
 	{
 		high_threshold = FOREGROUND;
 	}
+
+	// relabel foreground that is a shadow on the background (only paid for by foreground pixels)
+	if(low_threshold == FOREGROUND && shadowDist < m_params.LowThreshold())
+		low_threshold = SHADOW;
+	if(high_threshold == FOREGROUND && shadowDist < m_params.HighThreshold())
+		high_threshold = SHADOW;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// A pixel of nModes modes matching its dominant mode (the first one) changes the mixture in a 
+// way that can be deferred. With the complexity prior c, each frame maps the weights to
+// wi -> ((1-alpha)*wi - alpha*c + alpha*[i == 0]) / (1 - nModes*alpha*c) once normalized, which
+// moves every weight towards a fixed limit Li by the factor (1-alpha) / (1 - nModes*alpha*c):
+// L0 = (1-c)/(1-nModes*c) for the dominant mode and Li = -c/(1-nModes*c) for the others. The 
+// limits do not depend on alpha, so after k such frames each wi - Li is the stored one times 
+// the product of the k factors, and only that product is kept until the next frame needing the
+// whole mixture.
+//
+// The dominant weight only grows and the others only shrink meanwhile, so the exact update 
+// would keep the order of the modes and match the same mode. The fast path is not taken on a
+// frame on which the exact update would prune the weakest mode. Error bound against the exact
+// update: means and variances get the same updates, the weights are equal up to floating point
+// rounding (a relative error of about k*6e-8 after k deferred frames), and a label can only 
+// differ where such a rounding difference crosses a threshold.
+///////////////////////////////////////////////////////////////////////////////
+template <typename Pixel>
+bool ZivkovicAGMM::SubtractStablePixel(long posPixel, const Pixel& pixel, int nModes, float& decay)
+{
+	// the limits only exist while nModes*c < 1
+	if(nModes == 0 || nModes*m_complexity_prior >= 1)
+		return false;
+
+	GMM<Pixel::channels>* modes = Modes<Pixel::channels>() + posPixel;
+	float dominant = LimitWeight(nModes, true);
+	float weight = dominant + decay*(modes[0].weight - dominant);
+
+	// the exact update prunes the weakest mode when its decayed weight falls below alpha*c
+	if(nModes > 1)
+	{
+		float other = LimitWeight(nModes, false);
+		float weakest = other + decay*(modes[nModes-1].weight - other);
+		if((1-m_alpha)*weakest < 2*m_alpha*m_complexity_prior)
+			return false;
+	}
+
+	// the pixel must be background for both thresholds
+	float var = modes[0].sigma;
+	float delta[Pixel::channels];
+	float dist = 0;
+	for(int ch = 0; ch < Pixel::channels; ++ch)
+	{
+		delta[ch] = modes[0].mu[ch] - pixel(ch);
+		dist += delta[ch]*delta[ch];
+	}
+
+	if(dist >= std::min(m_params.LowThreshold(), m_params.HighThreshold())*var)
+		return false;
+
+	// same update of the dominant mode as SubtractPixel(), the weights only move to their limits
+	float k = m_alpha/weight;
+	for(int ch = 0; ch < Pixel::channels; ++ch)
+	{
+		modes[0].mu[ch] -= k*delta[ch];
+	}
+
+	float sigmanew = var + k*(dist-var);
+	modes[0].sigma = sigmanew < 4 ? 4 : sigmanew > 5*m_variance ? 5*m_variance : sigmanew;
+
+	decay *= (1-m_alpha) / (1 - nModes*m_alpha*m_complexity_prior);
+	return true;
+}
+
+template <int CN>
+void ZivkovicAGMM::ApplyDecay(long posPixel, int nModes, float& decay)
+{
+	if(decay == 1.0f)
+		return;
+
+	GMM<CN>* modes = Modes<CN>() + posPixel;
+	for(int i = 0; i < nModes; ++i)
+	{
+		float limit = LimitWeight(nModes, i == 0);
+		modes[i].weight = limit + decay*(modes[i].weight - limit);
+	}
+
+	decay = 1.0f;
+}
+
+float ZivkovicAGMM::LimitWeight(int nModes, bool dominant) const
+{
+	float c = m_complexity_prior;
+	return ((dominant ? 1 : 0) - c) / (1 - nModes*c);
+}
+
+template <typename Pixel>
+float ZivkovicAGMM::ShadowDistance(long posPixel, int numModes, const Pixel& pixel)
+{
+	const GMM<Pixel::channels>* modes = Modes<Pixel::channels>() + posPixel;
+
+	// A shadow scales the background by a factor a between ShadowRatio() and 1. For each
+	// background mode, a is the least squares fit of the scaled mean to the pixel and the 
+	// distance of the scaled mode to the pixel is measured in scaled variances.
+	float best = FLT_MAX;
+	float sum = 0.0f;
+	for(int i = 0; i < numModes && sum < m_bg_threshold; ++i)
+	{
+		float numerator = 0.0f;
+		float denominator = 0.0f;
+		for(int ch = 0; ch < Pixel::channels; ++ch)
+		{
+			numerator += modes[i].mu[ch]*pixel[ch];
+			denominator += modes[i].mu[ch]*modes[i].mu[ch];
+		}
+
+		if(denominator > 0 && numerator <= denominator && numerator >= m_params.ShadowRatio()*denominator)
+		{
+			float a = numerator / denominator;
+			float dist = 0.0f;
+			for(int ch = 0; ch < Pixel::channels; ++ch)
+			{
+				float delta = a*modes[i].mu[ch] - pixel[ch];
+				dist += delta*delta;
+			}
+			best = std::min(best, dist / (modes[i].sigma*a*a));
+		}
+
+		sum += modes[i].weight;
+	}
+
+	return best;
 }
 
 
@@ -383,30 +584,82 @@ void ZivkovicAGMM::SubtractPixel(long posPixel, const RgbPixel& pixel, unsigned
 //					(the memory should already be reserved) 
 //					values: 255-foreground, 125-shadow, 0-background
 ///////////////////////////////////////////////////////////////////////////////
-void ZivkovicAGMM::Subtract(int frame_num, const RgbImage& data,  
+void ZivkovicAGMM::Subtract(int frame_num, const BaseImage& data,  
 															BwImage& low_threshold_mask, BwImage& high_threshold_mask)
+{
+	CV_Assert(data.type() == m_params.Type());
+
+	m_alpha = FrameAlpha(m_params.Alpha());
+
+	// pixels outside of the region of interest are background (masks passed to a call
+	// restricted by a process mask already hold the previous, cleared, values)
+	if(!m_params.Roi().Empty() && m_process_mask.empty())
+	{
+		low_threshold_mask.setTo(BACKGROUND);
+		high_threshold_mask.setTo(BACKGROUND);
+	}
+
+	DispatchPixelType(data.type(), [&](auto pixel) { SubtractImpl<decltype(pixel)>(data, low_threshold_mask, high_threshold_mask); });
+}
+
+template <typename Pixel>
+void ZivkovicAGMM::SubtractImpl(const BaseImage& data, BwImage& low_threshold_mask, BwImage& high_threshold_mask)
 {
 	unsigned char low_threshold, high_threshold;
 
+	// mode changes are only counted while statistics are enabled
+	GmmModeCounts mode_counts;
+	GmmModeCounts* counts = m_stats.empty() ? NULL : &mode_counts;
+
 	// update each pixel of the image
 	long posPixel;
-	unsigned char* pUsedModes=m_modes_per_pixel;
-	for(unsigned int r = 0; r < m_params.Height(); ++r)
+	for(const PixelSpan& span : m_spans)
 	{
-		for(unsigned int c = 0; c < m_params.Width(); ++c)
+		unsigned int r = span.row;
+		unsigned char* pUsedModes=m_modes_per_pixel + span.offset;
+		for(int c = span.begin; c < span.end; ++c, ++pUsedModes)
 		{
+			if(!IsProcessed(r,c))
+				continue;
+
 			//update model+ background subtract
-			posPixel=(r*m_params.Width()+c)*m_params.MaxModes();
-			SubtractPixel(posPixel, data.at< RgbPixel >(r,c), pUsedModes, low_threshold, high_threshold);
+			posPixel=(pUsedModes-m_modes_per_pixel)*m_params.MaxModes();
+			SubtractPixel(posPixel, data.at< Pixel >(r,c), pUsedModes, low_threshold, high_threshold, counts);
 			low_threshold_mask.at< uchar >(r,c) = low_threshold;
 			high_threshold_mask.at< uchar >(r,c) = high_threshold;
+		}
+	}
+
+	m_background_dirty = true;
 
-			m_background.at< RgbPixel >( r,c )[0] = (unsigned char)m_modes[posPixel].muR;
-			m_background.at< RgbPixel >(r,c)[1] = (unsigned char)m_modes[posPixel].muG;
-			m_background.at< RgbPixel >(r,c)[2] = (unsigned char)m_modes[posPixel].muB;
+	if(counts)
+		m_stats->AddModes(mode_counts);
+}
 
-			pUsedModes++;
+void ZivkovicAGMM::UpdateBackground() const
+{
+	if(!m_background_dirty)
+		return;
+
+	DispatchPixelType(m_params.Type(), [&](auto pixel) { UpdateBackgroundImpl<decltype(pixel)>(); });
+	m_background_dirty = false;
+}
+
+template <typename Pixel>
+void ZivkovicAGMM::UpdateBackgroundImpl() const
+{
+	const GMM<Pixel::channels>* modes = m_modes.ptr< GMM<Pixel::channels> >();
+
+	for(const PixelSpan& span : m_spans)
+	{
+		Pixel* background = m_background.ptr< Pixel >(span.row);
+		unsigned int pixel = span.offset;
+		for(int c = span.begin; c < span.end; ++c, ++pixel)
+		{
+			for(int ch = 0; ch < Pixel::channels; ++ch)
+			{
+				background[c][ch] = (typename Pixel::value_type)modes[pixel*m_params.MaxModes()].mu[ch];
+			}
 		}
 	}
 }
-
@@ -49,11 +49,19 @@ namespace BackgroundSubtraction
 class ZivkovicParams : public BgsParams
 {
 public:
+	ZivkovicParams() : m_shadow_detection(false), m_shadow_ratio(0.5f), m_lazy_decay(false) {}
+
 	float &LowThreshold() { return m_low_threshold; }
 	float &HighThreshold() { return m_high_threshold; }
 
 	float &Alpha() { return m_alpha; }
 	int &MaxModes() { return m_max_modes; }
+	int MaxModes() const { return m_max_modes; }
+
+	bool &ShadowDetection() { return m_shadow_detection; }
+	float &ShadowRatio() { return m_shadow_ratio; }
+
+	bool &LazyDecay() { return m_lazy_decay; }
 
 private:
 	// Threshold on the squared dist. to decide when a sample is close to an existing 
@@ -72,18 +80,28 @@ private:
 
 	// Maximum number of modes (Gaussian components) that will be used per pixel
 	int m_max_modes;
+
+	// If true, foreground pixels that are a darkened copy of a background mode are labelled
+	// SHADOW instead of FOREGROUND. A shadow may darken the background down to m_shadow_ratio
+	// of its brightness, and the darkened mode must be within the threshold of the mask.
+	bool m_shadow_detection;
+	float m_shadow_ratio;
+
+	// If true, a pixel matching its dominant mode only updates that mode and defers the decay of
+	// the weights to the next frame that needs the whole mixture (see ZivkovicAGMM::SubtractStablePixel).
+	bool m_lazy_decay;
 };
 
 // --- Zivkovic AGMM BGS algorithm ---
 class ZivkovicAGMM : public Bgs
 {
 private:
+	// Gaussian component of a pixel with CN channels
+	template <int CN>
 	struct GMM
 	{
 		float sigma;
-		float muR;
-		float muG;
-		float muB;
+		float mu[CN];
 		float weight;
 	};
 
@@ -93,16 +111,43 @@ public:
 
 	void Initalize(const BgsParams& param);
 
-	void InitModel(const RgbImage& data);
-	void Subtract(int frame_num, const RgbImage& data,  
+	void InitModel(const BaseImage& data);
+	bool WarpModel(const cv::Mat& transform);
+	void Subtract(int frame_num, const BaseImage& data,  
 									BwImage& low_threshold_mask, BwImage& high_threshold_mask);	
-	void Update(int frame_num, const RgbImage& data,  const BwImage& update_mask);
+	void Update(int frame_num, const BaseImage& data,  const BwImage& update_mask);
 
-	RgbImage Background() { return m_background; }
+	BaseImage Background() { UpdateBackground(); return m_background; }
+	void getBackgroundImage(cv::OutputArray backgroundImage) const { UpdateBackground(); m_background.copyTo(backgroundImage); }
 
 private:
-	void SubtractPixel(long posPixel, const RgbPixel& pixel, unsigned char* pModesUsed, 
-																	unsigned char& lowThreshold, unsigned char& highThreshold);
+	// per-pixel code for pixels of type Pixel (cv::Vec< T, channels > of uchar, ushort or float)
+	template <typename Pixel> void SubtractImpl(const BaseImage& data, 
+																							BwImage& low_threshold_mask, BwImage& high_threshold_mask);
+	// counts - mode changes are added to it if not NULL
+	template <typename Pixel> void SubtractPixel(long posPixel, const Pixel& pixel, unsigned char* pModesUsed, 
+																							unsigned char& lowThreshold, unsigned char& highThreshold,
+																							GmmModeCounts* counts);
+
+	template <int CN> GMM<CN>* Modes() { return m_modes.ptr< GMM<CN> >(); }
+
+	// Lazy decay: update a pixel matching its dominant mode without touching the other modes and
+	// return true, or return false if the whole mixture is needed. ApplyDecay() brings the weights
+	// of a pixel up to date.
+	template <typename Pixel> bool SubtractStablePixel(long posPixel, const Pixel& pixel, int nModes, float& decay);
+	template <int CN> void ApplyDecay(long posPixel, int nModes, float& decay);
+
+	// Weight all weights of a pixel with nModes modes converge to under the complexity prior
+	// while the pixel matches its dominant mode (dominant - true for the dominant mode)
+	float LimitWeight(int nModes, bool dominant) const;
+
+	// Smallest squared distance, in variances, of a shadowed background mode to the pixel 
+	// (FLT_MAX if no background mode can be shadowed into it)
+	template <typename Pixel> float ShadowDistance(long posPixel, int numModes, const Pixel& pixel);
+
+	// Compute m_background from the model if the model changed since it was last computed
+	void UpdateBackground() const;
+	template <typename Pixel> void UpdateBackgroundImpl() const;
 	
 	// User adjustable parameters
 	ZivkovicParams m_params;
@@ -113,6 +158,9 @@ private:
 	// it is considered foreground
 	float m_bg_threshold; //1-cf from the paper
 
+	// Learning rate of the current frame
+	float m_alpha;
+
 	// Initial variance for the newly generated components. 
 	// It will will influence the speed of adaptation. A good guess should be made. 
 	// A simple way is to estimate the typical standard deviation from the images.
@@ -123,15 +171,27 @@ private:
 	float m_complexity_prior;
 	
 	//data
-	int m_num_bands;	//only RGB now ==3
+	int m_num_bands;	//number of channels of the frames (1 or 3)
 
-	// dynamic array for the mixture of Gaussians
-	GMM* m_modes;
+	// Runs of pixels inside the region of interest. Model arrays only hold these pixels.
+	PixelSpans m_spans;
 
-	RgbImage m_background;
+	// mixture of Gaussians of each pixel, stored as GMM<m_num_bands> (m_num_bands+2 floats per mode)
+	ModelArena m_modes_arena;
+	BaseImage m_modes;
+
+	// Most significant mean of each pixel, computed on request from the model
+	mutable BaseImage m_background;
+	mutable bool m_background_dirty;
 
 	//number of Gaussian components per pixel
+	ModelArena m_modes_per_pixel_arena;
 	unsigned char* m_modes_per_pixel;
+
+	// Lazy decay: product of the factors not yet applied to the distance of the weights of each
+	// pixel to their limit (1 if none)
+	ModelArena m_decay_arena;
+	float* m_decay;
 };
 
 };
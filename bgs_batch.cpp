@@ -0,0 +1,681 @@
+/****************************************************************************
+*
+*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+******************************************************************************/
+
+/****************************************************************************
+*
+* bgs_batch.cpp
+*
+* Purpose: Runs an algorithm over many recorded clips and writes the results
+*          of each clip to files named after it. Clips are processed in
+*          parallel, one per job, and each clip is a pipeline of a decoding,
+*          a subtraction and an encoding thread connected by bounded queues,
+*          so reading and writing media overlap with the algorithm. When
+*          several jobs run, the subtraction thread of each job is pinned to
+*          its own processor, spread over the NUMA nodes, before it creates
+*          the model, so the model is placed on the node that processes it,
+*          and the algorithm runs serially on that thread (see BgsRunner.hpp).
+*          A throughput summary is printed when all clips are done.
+*
+*          Arguments containing * or ? are expanded with cv::glob. Outputs of
+*          clip.avi go to the output directory, which must exist:
+*
+*          video   clip_mask.avi, the foreground masks as a grayscale video
+*          packed  clip_mask.bin, the masks with one bit per pixel: the 8 bytes
+*                  "BGSMASK1", width and height as 32 bit little endian
+*                  integers, then for each frame height rows of (width + 7) / 8
+*                  bytes, most significant bit first (1 = foreground, shadows
+*                  are background)
+*          stats   clip_stats.csv, frame,foreground,shadow,fraction per frame
+
+Usage:
+    bgs_batch algorithm clip... [options] [parameter=value ...]
+
+    --output=dir    directory of the outputs (default .)
+    --format=list   comma separated outputs: video, packed and stats (default video)
+    --fourcc=code   codec of video outputs (default MJPG, FFV1 is lossless)
+    --jobs=n        clips processed at the same time (default one per processor)
+    --threads=n     worker threads of each algorithm (default 1 if several clips run
+                    at the same time, otherwise all processors)
+    --queue=n       frames buffered between the stages of a clip (default 8)
+    --no-pin        leave the placement of the jobs to the operating system
+
+    bgs_batch ZivkovicAGMM "archive/2024-*.avi" --output=masks --format=packed,stats --jobs=8
+******************************************************************************/
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/videoio.hpp>
+
+#include "BgsFactory.hpp"
+#include "Topology.hpp"
+
+using namespace Algorithms::BackgroundSubtraction;
+
+namespace
+{
+    struct BatchOptions
+    {
+        std::string algorithm;
+        BgsParamMap params;
+        std::string output_dir;
+        bool        video;
+        bool        packed;
+        bool        stats;
+        int         fourcc;
+        size_t      queue;
+    };
+
+    // Processing times and placement of a clip.
+    struct ClipResult
+    {
+        std::string error;      // empty if the clip was processed completely
+        int         cpu;        // processor the subtraction ran on (-1 if not pinned)
+        int         node;       // NUMA node of the model
+        int         frames;
+        double      seconds;    // from opening the clip to closing its outputs
+        double      decode;     // busy time of the stages
+        double      subtract;
+        double      encode;
+    };
+
+    double  Seconds( int64 ticks )
+    {
+        return ticks / cv::getTickFrequency();
+    }
+
+    // Queue of limited capacity between two pipeline stages. Closing the queue ends it for both
+    // sides: the consumer gets the remaining items, and the producer cannot add more.
+    template< typename T >
+    class BoundedQueue
+    {
+    public:
+        explicit BoundedQueue( size_t capacity ) : m_capacity( std::max< size_t >( capacity, 1 ) ), m_closed( false ) {}
+
+        // Block while the queue is full. Returns false if the queue was closed.
+        bool    Push( T item )
+        {
+            std::unique_lock< std::mutex > lock( m_mutex );
+            m_not_full.wait( lock, [ this ] { return m_closed || m_items.size() < m_capacity; } );
+            if( m_closed )
+                return false;
+
+            m_items.push_back( std::move( item ) );
+            m_not_empty.notify_one();
+            return true;
+        }
+
+        // Block while the queue is empty. Returns false once it is empty and closed.
+        bool    Pop( T& item )
+        {
+            std::unique_lock< std::mutex > lock( m_mutex );
+            m_not_empty.wait( lock, [ this ] { return m_closed || !m_items.empty(); } );
+            if( m_items.empty() )
+                return false;
+
+            item = std::move( m_items.front() );
+            m_items.pop_front();
+            m_not_full.notify_one();
+            return true;
+        }
+
+        void    Close()
+        {
+            std::lock_guard< std::mutex > lock( m_mutex );
+            m_closed = true;
+            m_not_full.notify_all();
+            m_not_empty.notify_all();
+        }
+
+    private:
+        size_t                  m_capacity;
+        bool                    m_closed;
+        std::deque< T >         m_items;
+        std::mutex              m_mutex;
+        std::condition_variable m_not_full;
+        std::condition_variable m_not_empty;
+    };
+
+    // Name of a clip without directory and extension.
+    std::string     ClipName( const std::string& path )
+    {
+        size_t slash = path.find_last_of( "/\\" );
+        std::string name = slash == std::string::npos ? path : path.substr( slash + 1 );
+        size_t dot = name.find_last_of( '.' );
+        return dot == std::string::npos || dot == 0 ? name : name.substr( 0, dot );
+    }
+
+    void    WriteUint32( std::ofstream& stream, uint32_t value )
+    {
+        unsigned char bytes[ 4 ] = { static_cast< unsigned char >( value ), static_cast< unsigned char >( value >> 8 ),
+                                     static_cast< unsigned char >( value >> 16 ), static_cast< unsigned char >( value >> 24 ) };
+        stream.write( reinterpret_cast< const char* >( bytes ), sizeof( bytes ) );
+    }
+
+    // Outputs of a clip, opened with the size of its first mask.
+    class MaskWriter
+    {
+    public:
+        MaskWriter( const BatchOptions& options, const std::string& clip, double fps ) :
+            m_options( options ),
+            m_base( options.output_dir + "/" + ClipName( clip ) ),
+            m_fps( fps > 0 ? fps : 25 ),
+            m_frame_num( 0 )
+        {}
+
+        void    Write( const BwImage& mask )
+        {
+            if( m_frame_num == 0 )
+            {
+                Open( mask.size() );
+            }
+
+            if( m_options.video )
+            {
+                m_video.write( mask );
+            }
+
+            if( m_options.packed || m_options.stats )
+            {
+                WritePackedAndStats( mask );
+            }
+
+            if( ( m_options.packed && !m_packed ) || ( m_options.stats && !m_stats ) )
+            {
+                CV_Error( cv::Error::StsError, "Could not write the outputs of " + m_base );
+            }
+
+            ++m_frame_num;
+        }
+
+    private:
+        void    Open( cv::Size size )
+        {
+            if( m_options.video && !m_video.open( m_base + "_mask.avi", m_options.fourcc, m_fps, size, false ) )
+            {
+                CV_Error( cv::Error::StsError, "Could not open " + m_base + "_mask.avi" );
+            }
+
+            if( m_options.packed )
+            {
+                m_packed.open( m_base + "_mask.bin", std::ios::binary );
+                m_packed.write( "BGSMASK1", 8 );
+                WriteUint32( m_packed, static_cast< uint32_t >( size.width ) );
+                WriteUint32( m_packed, static_cast< uint32_t >( size.height ) );
+                m_row.resize( ( size.width + 7 ) / 8 );
+            }
+
+            if( m_options.stats )
+            {
+                m_stats.open( m_base + "_stats.csv" );
+                m_stats << "frame,foreground,shadow,fraction" << std::endl;
+            }
+        }
+
+        // Packed rows and pixel counts come from a single pass over the mask.
+        void    WritePackedAndStats( const BwImage& mask )
+        {
+            int64 foreground = 0;
+            int64 shadow = 0;
+
+            for( int r = 0; r < mask.rows; ++r )
+            {
+                const uchar* pixels = mask.ptr< uchar >( r );
+                std::fill( m_row.begin(), m_row.end(), 0 );
+
+                for( int c = 0; c < mask.cols; ++c )
+                {
+                    if( pixels[ c ] == Bgs::SHADOW )
+                    {
+                        ++shadow;
+                    }
+                    else if( pixels[ c ] != 0 )
+                    {
+                        ++foreground;
+                        if( !m_row.empty() )
+                            m_row[ c >> 3 ] |= static_cast< unsigned char >( 0x80 >> ( c & 7 ) );
+                    }
+                }
+
+                if( m_options.packed )
+                {
+                    m_packed.write( reinterpret_cast< const char* >( m_row.data() ), m_row.size() );
+                }
+            }
+
+            if( m_options.stats )
+            {
+                double pixels = static_cast< double >( mask.total() );
+                m_stats << m_frame_num << "," << foreground << "," << shadow << ","
+                        << ( pixels > 0 ? foreground / pixels : 0 ) << "\n";
+            }
+        }
+
+        const BatchOptions&         m_options;
+        std::string                 m_base;
+        double                      m_fps;
+        int                         m_frame_num;
+
+        cv::VideoWriter             m_video;
+        std::ofstream               m_packed;
+        std::ofstream               m_stats;
+        std::vector< unsigned char >    m_row;
+    };
+
+    // Decode, subtract and encode a clip on three threads.
+    // Called on the thread that subtracts. serial keeps the loops of the algorithm on it.
+    ClipResult  ProcessClip( const BatchOptions& options, const std::string& clip, bool serial )
+    {
+        ClipResult result = ClipResult();
+        int64 start = cv::getTickCount();
+
+        cv::VideoCapture reader( clip );
+        if( !reader.isOpened() )
+        {
+            result.error = "could not open the clip";
+            return result;
+        }
+
+        // single channel models are fed grayscale frames
+        BgsParamMap::const_iterator channels = options.params.find( "Channels" );
+        const bool gray = channels != options.params.end() && channels->second == 1;
+
+        MaskWriter writer( options, clip, reader.get( cv::CAP_PROP_FPS ) );
+        BoundedQueue< cv::Mat > frames( options.queue );
+        BoundedQueue< BwImage > masks( options.queue );
+        std::exception_ptr decode_error;
+        std::exception_ptr subtract_error;
+        std::exception_ptr encode_error;
+        int64 decode_ticks = 0;
+        int64 encode_ticks = 0;
+
+        std::thread decoder( [ & ]
+        {
+            try
+            {
+                for( ;; )
+                {
+                    int64 begin = cv::getTickCount();
+                    cv::Mat frame;
+                    if( !reader.read( frame ) || frame.empty() )
+                        break;
+                    if( gray && frame.channels() == 3 )
+                    {
+                        cv::cvtColor( frame, frame, cv::COLOR_BGR2GRAY );
+                    }
+                    decode_ticks += cv::getTickCount() - begin;
+
+                    if( !frames.Push( frame ) )
+                        break;
+                }
+            }
+            catch( ... )
+            {
+                decode_error = std::current_exception();
+            }
+            frames.Close();
+        } );
+
+        std::thread encoder( [ & ]
+        {
+            try
+            {
+                BwImage mask;
+                while( masks.Pop( mask ) )
+                {
+                    int64 begin = cv::getTickCount();
+                    writer.Write( mask );
+                    encode_ticks += cv::getTickCount() - begin;
+                }
+            }
+            catch( ... )
+            {
+                encode_error = std::current_exception();
+            }
+            // stop the other stages if the outputs failed
+            masks.Close();
+            frames.Close();
+        } );
+
+        int64 subtract_ticks = 0;
+        try
+        {
+            cv::Ptr< Bgs > bgs;
+            cv::Mat frame;
+            while( frames.Pop( frame ) )
+            {
+                int64 begin = cv::getTickCount();
+                if( !bgs )
+                {
+                    bgs = createBgs( options.algorithm, frame.cols, frame.rows, options.params );
+                    bgs->SetSerial( serial );
+                }
+
+                // each mask is a new image, owned by the queue until it is written
+                BwImage mask;
+                bgs->apply( frame, mask );
+                subtract_ticks += cv::getTickCount() - begin;
+
+                if( !masks.Push( mask ) )
+                    break;
+                ++result.frames;
+            }
+        }
+        catch( ... )
+        {
+            subtract_error = std::current_exception();
+            frames.Close();
+        }
+        masks.Close();
+
+        decoder.join();
+        encoder.join();
+
+        result.decode = Seconds( decode_ticks );
+        result.subtract = Seconds( subtract_ticks );
+        result.encode = Seconds( encode_ticks );
+
+        for( const std::exception_ptr& error : { subtract_error, encode_error, decode_error } )
+        {
+            if( !error || !result.error.empty() )
+                continue;
+
+            try
+            {
+                std::rethrow_exception( error );
+            }
+            catch( const std::exception& e )
+            {
+                result.error = e.what();
+            }
+            catch( ... )
+            {
+                result.error = "unknown error";
+            }
+        }
+
+        if( result.error.empty() && result.frames == 0 )
+        {
+            result.error = "no frames";
+        }
+
+        result.seconds = Seconds( cv::getTickCount() - start );
+        return result;
+    }
+
+    double  PerFrame( double seconds, int64 frames )
+    {
+        return frames == 0 ? 0 : seconds * 1e3 / frames;
+    }
+
+    int     Usage()
+    {
+        std::cerr << "Usage: bgs_batch algorithm clip... [options] [parameter=value ...]" << std::endl
+                  << "Options: --output=dir --format=video,packed,stats --fourcc=code --jobs=n --threads=n --queue=n --no-pin" << std::endl;
+        return 1;
+    }
+}
+
+int     main( int argc, const char* argv[] )
+{
+    if( argc < 3 )
+    {
+        return Usage();
+    }
+
+    BatchOptions options;
+    options.algorithm = argv[ 1 ];
+    options.output_dir = ".";
+    options.video = true;
+    options.packed = false;
+    options.stats = false;
+    options.fourcc = cv::VideoWriter::fourcc( 'M', 'J', 'P', 'G' );
+    options.queue = 8;
+
+    std::vector< std::string > clips;
+    int jobs = static_cast< int >( std::max( std::thread::hardware_concurrency(), 1u ) );
+    int threads = -1;
+    bool pin = true;
+
+    int i = 2;
+    try
+    {
+        for( ; i < argc; ++i )
+        {
+            std::string arg = argv[ i ];
+            if( arg == "--no-pin" )
+            {
+                pin = false;
+                continue;
+            }
+
+            size_t equals = arg.find( '=' );
+            if( equals == std::string::npos )
+            {
+                if( arg.compare( 0, 2, "--" ) == 0 )
+                {
+                    std::cerr << "Unknown option '" << arg << "'." << std::endl;
+                    return Usage();
+                }
+
+                if( arg.find_first_of( "*?" ) == std::string::npos )
+                {
+                    clips.push_back( arg );
+                    continue;
+                }
+
+                std::vector< cv::String > matches;
+                cv::glob( arg, matches );
+                if( matches.empty() )
+                {
+                    std::cerr << "No clips match '" << arg << "'." << std::endl;
+                    return 1;
+                }
+                clips.insert( clips.end(), matches.begin(), matches.end() );
+                continue;
+            }
+
+            std::string key = arg.substr( 0, equals );
+            std::string value = arg.substr( equals + 1 );
+            if( key == "--output" )
+            {
+                options.output_dir = value;
+            }
+            else if( key == "--format" )
+            {
+                options.video = false;
+                std::istringstream formats( value );
+                std::string format;
+                while( std::getline( formats, format, ',' ) )
+                {
+                    if( format == "video" )
+                        options.video = true;
+                    else if( format == "packed" )
+                        options.packed = true;
+                    else if( format == "stats" )
+                        options.stats = true;
+                    else
+                    {
+                        std::cerr << "Unknown output format '" << format << "'." << std::endl;
+                        return Usage();
+                    }
+                }
+            }
+            else if( key == "--fourcc" )
+            {
+                if( value.size() != 4 )
+                {
+                    std::cerr << "Expected a four character code instead of '" << value << "'." << std::endl;
+                    return Usage();
+                }
+                options.fourcc = cv::VideoWriter::fourcc( value[ 0 ], value[ 1 ], value[ 2 ], value[ 3 ] );
+            }
+            else if( key == "--jobs" )
+            {
+                jobs = std::max( std::stoi( value ), 1 );
+            }
+            else if( key == "--threads" )
+            {
+                threads = std::stoi( value );
+            }
+            else if( key == "--queue" )
+            {
+                options.queue = static_cast< size_t >( std::max( std::stoi( value ), 1 ) );
+            }
+            else if( key.compare( 0, 2, "--" ) == 0 )
+            {
+                std::cerr << "Unknown option '" << arg << "'." << std::endl;
+                return Usage();
+            }
+            else
+            {
+                options.params[ key ] = std::stod( value );
+            }
+        }
+    }
+    catch( const std::exception& )
+    {
+        // std::stoi() and std::stod() throw on values that are not numbers
+        std::cerr << "Invalid value in '" << argv[ i ] << "'." << std::endl;
+        return Usage();
+    }
+
+    if( clips.empty() || !( options.video || options.packed || options.stats ) )
+    {
+        return Usage();
+    }
+
+    // clips of the same name would overwrite each other's outputs
+    std::set< std::string > names;
+    for( const std::string& clip : clips )
+    {
+        if( !names.insert( ClipName( clip ) ).second )
+        {
+            std::cerr << "Several clips are named " << ClipName( clip ) << ", their outputs would collide." << std::endl;
+            return 1;
+        }
+    }
+
+    // fail on unknown algorithms and parameters before any clip is opened
+    try
+    {
+        createBgs( options.algorithm, 64, 64, options.params );
+    }
+    catch( const cv::Exception& e )
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    // parallel clips scale better than parallel loops inside each algorithm
+    jobs = std::min( jobs, static_cast< int >( clips.size() ) );
+    if( threads < 0 && jobs > 1 )
+    {
+        threads = 1;
+    }
+    if( threads >= 0 )
+    {
+        cv::setNumThreads( threads );
+    }
+
+    // one processor per job, alternating between the NUMA nodes
+    std::vector< int > cpus;
+    if( pin && jobs > 1 )
+    {
+        cpus = InterleavedCpus();
+    }
+
+    std::vector< ClipResult > results( clips.size() );
+    std::atomic< size_t > next_clip( 0 );
+    std::mutex report_mutex;
+    int64 start = cv::getTickCount();
+
+    std::vector< std::thread > workers;
+    for( int j = 0; j < jobs; ++j )
+    {
+        workers.emplace_back( [ &, j ]
+        {
+            // pinned before any model is created, so each model is first touched on its node
+            int cpu = cpus.empty() ? -1 : cpus[ j % cpus.size() ];
+            bool pinned = cpu >= 0 && PinCurrentThread( cpu );
+            int node = CurrentNumaNode();
+
+            for( size_t i = next_clip++; i < clips.size(); i = next_clip++ )
+            {
+                results[ i ] = ProcessClip( options, clips[ i ], pinned );
+                results[ i ].cpu = pinned ? cpu : -1;
+                results[ i ].node = node;
+
+                const ClipResult& result = results[ i ];
+                std::lock_guard< std::mutex > lock( report_mutex );
+                if( !result.error.empty() )
+                {
+                    std::cerr << clips[ i ] << ": " << result.error << " (after " << result.frames << " frames)" << std::endl;
+                    continue;
+                }
+
+                std::cout << clips[ i ] << ": " << result.frames << " frames in " << result.seconds << " s, "
+                          << result.frames / result.seconds << " fps (decode " << PerFrame( result.decode, result.frames )
+                          << " ms, subtract " << PerFrame( result.subtract, result.frames ) << " ms, encode "
+                          << PerFrame( result.encode, result.frames ) << " ms per frame, ";
+                if( result.cpu >= 0 )
+                    std::cout << "cpu " << result.cpu << ", node " << result.node << ")" << std::endl;
+                else
+                    std::cout << "not pinned)" << std::endl;
+            }
+        } );
+    }
+
+    for( std::thread& worker : workers )
+    {
+        worker.join();
+    }
+
+    double seconds = Seconds( cv::getTickCount() - start );
+    int failed = 0;
+    int64 frames = 0;
+    double decode = 0, subtract = 0, encode = 0;
+    for( const ClipResult& result : results )
+    {
+        failed += result.error.empty() ? 0 : 1;
+        frames += result.frames;
+        decode += result.decode;
+        subtract += result.subtract;
+        encode += result.encode;
+    }
+
+    std::cout << "Clips:      " << clips.size() - failed << " processed, " << failed << " failed (" << jobs << " jobs)" << std::endl;
+    std::cout << "Frames:     " << frames << " in " << seconds << " s" << std::endl;
+    std::cout << "FPS:        " << ( seconds > 0 ? frames / seconds : 0 ) << std::endl;
+    std::cout << "Per frame:  decode " << PerFrame( decode, frames ) << " ms, subtract "
+              << PerFrame( subtract, frames ) << " ms, encode "
+              << PerFrame( encode, frames ) << " ms" << std::endl;
+
+    return failed == 0 ? 0 : 1;
+}
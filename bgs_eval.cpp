@@ -0,0 +1,435 @@
+/****************************************************************************
+*
+*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+******************************************************************************/
+
+/****************************************************************************
+*
+* bgs_eval.cpp
+*
+* Purpose: Evaluates an algorithm on a clip with ground truth masks and
+*          reports precision, recall, F-measure, percentage of wrong
+*          classifications and the frame rate of the algorithm alone.
+*
+*          The clip and the ground truth are opened with cv::VideoCapture,
+*          so either may be a video file or an image sequence pattern such
+*          as groundtruth/gt%06d.png. Instead of a clip, a synthetic scene of
+*          any size can be generated with --synthetic. Frames before --first
+*          are used to learn the background but are not scored.
+
+Usage:
+    bgs_eval algorithm clip groundtruth [options] [parameter=value ...]
+    bgs_eval algorithm --synthetic=WIDTHxHEIGHT [--frames=n] [--seed=n] [--noise=sigma] [--jitter=pixels]
+             [options] [parameter=value ...]
+
+    --first=n   first scored frame
+    --last=n    last processed frame
+    --csv   print a single comma separated line:
+            algorithm,parameters,frames,precision,recall,fmeasure,pwc,fps[,digest]
+    --digest        print a hash of the low and high threshold masks and the
+                    background of every processed frame
+    --expect=hash   exit with status 2 if the hash differs from the golden value
+    --threads=n     number of worker threads (1 runs serially)
+    --no-simd       disable vectorized code paths
+    --cpu=path      run the kernels compiled for baseline, sse4.2, avx2 or avx512 instead
+                    of the best path of the processor (see CpuDispatch.hpp), exit with
+                    status 77 if the build or the processor lacks the path
+    --warmup=rate   learn with a rate of max(rate, 1/(n+1)) on frame n instead of the
+                    rate of the parameters (see LearningRateSchedule::WarmUp)
+    --illumination[=tolerance]
+                    compensate global illumination changes in front of the
+                    algorithm (see IlluminationBgs, default tolerance 0.03)
+    --frame-skip[=interval]
+                    fully process every interval-th frame and only the pixels that changed
+                    on the others (see FrameSkipBgs, default interval 10)
+    --follow-camera warp the model with the camera motion of a synthetic scene before
+                    each frame instead of learning the jitter (see Bgs::WarpModel)
+
+    The output of an algorithm must not depend on the execution mode, so the
+    same golden hash holds for any --threads, --no-simd and --cpu, e.g.
+
+    bgs_eval AdaptiveMedianBGS --synthetic=320x240 --frames=100 --expect=<hash> --threads=1 --no-simd
+******************************************************************************/
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/videoio.hpp>
+
+#include "BgsEvaluation.hpp"
+#include "BgsFactory.hpp"
+#include "CpuDispatch.hpp"
+#include "FrameSkipBgs.hpp"
+#include "IlluminationBgs.hpp"
+#include "SyntheticScene.hpp"
+
+using namespace Algorithms::BackgroundSubtraction;
+
+namespace
+{
+    int     Usage()
+    {
+        std::cerr << "Usage: bgs_eval algorithm clip groundtruth [options] [parameter=value ...]" << std::endl
+                  << "       bgs_eval algorithm --synthetic=WIDTHxHEIGHT [--frames=n] [--seed=n] [--noise=sigma] [--jitter=pixels]" << std::endl
+                  << "                [options] [parameter=value ...]" << std::endl
+                  << "Options: --first=n --last=n --csv --digest --expect=hash --threads=n --no-simd --cpu=path --warmup=rate --illumination[=tolerance] --frame-skip[=interval] --follow-camera" << std::endl;
+        return 1;
+    }
+}
+
+int     main( int argc, const char* argv[] )
+{
+    if( argc < 3 )
+    {
+        return Usage();
+    }
+
+    std::string algorithm = argv[ 1 ];
+    std::vector< std::string > files;
+
+    int first = 0;
+    int last = -1;
+    bool csv = false;
+    bool digest = false;
+    std::string expected;
+    bool synthetic = false;
+    bool follow_camera = false;
+    double illumination = -1;
+    int frame_skip = 0;
+    double warmup = -1;
+    SyntheticSceneParams scene_params;
+    BgsParamMap params;
+    std::ostringstream param_list;
+
+    int i = 2;
+    try
+    {
+        for( ; i < argc; ++i )
+        {
+            std::string arg = argv[ i ];
+            if( arg == "--csv" )
+            {
+                csv = true;
+                continue;
+            }
+            if( arg == "--digest" )
+            {
+                digest = true;
+                continue;
+            }
+            if( arg == "--no-simd" )
+            {
+                cv::setUseOptimized( false );
+                continue;
+            }
+            if( arg == "--follow-camera" )
+            {
+                follow_camera = true;
+                continue;
+            }
+            if( arg == "--illumination" )
+            {
+                illumination = 0.03;
+                continue;
+            }
+            if( arg == "--frame-skip" )
+            {
+                frame_skip = 10;
+                continue;
+            }
+
+            size_t equals = arg.find( '=' );
+            if( equals == std::string::npos )
+            {
+                if( arg.compare( 0, 2, "--" ) == 0 )
+                {
+                    std::cerr << "Unknown option '" << arg << "'." << std::endl;
+                    return Usage();
+                }
+                files.push_back( arg );
+                continue;
+            }
+
+            std::string key = arg.substr( 0, equals );
+            std::string value = arg.substr( equals + 1 );
+            if( key == "--first" )
+            {
+                first = std::stoi( value );
+            }
+            else if( key == "--last" )
+            {
+                last = std::stoi( value );
+            }
+            else if( key == "--expect" )
+            {
+                expected = value;
+                digest = true;
+            }
+            else if( key == "--warmup" )
+            {
+                warmup = std::stod( value );
+            }
+            else if( key == "--illumination" )
+            {
+                illumination = std::stod( value );
+            }
+            else if( key == "--frame-skip" )
+            {
+                frame_skip = std::stoi( value );
+            }
+            else if( key == "--cpu" )
+            {
+                CpuPath path;
+                if( !CpuPathFromName( value, path ) )
+                {
+                    std::cerr << "Unknown CPU path '" << value << "'." << std::endl;
+                    return Usage();
+                }
+                if( !CpuPathSupported( path ) )
+                {
+                    // skipped by the golden tests
+                    std::cerr << "The " << value << " CPU path is not supported." << std::endl;
+                    return 77;
+                }
+                ForceCpuPath( path );
+            }
+            else if( key == "--threads" )
+            {
+                cv::setNumThreads( std::stoi( value ) );
+            }
+            else if( key == "--synthetic" )
+            {
+                int width, height;
+                char separator;
+                std::istringstream size( value );
+                if( !( size >> width >> separator >> height ) || separator != 'x' )
+                {
+                    std::cerr << "Expected --synthetic=WIDTHxHEIGHT instead of '" << arg << "'." << std::endl;
+                    return Usage();
+                }
+                scene_params.SetFrameSize( width, height );
+                synthetic = true;
+            }
+            else if( key == "--frames" )
+            {
+                last = std::stoi( value ) - 1;
+            }
+            else if( key == "--seed" )
+            {
+                scene_params.Seed() = std::stoull( value );
+            }
+            else if( key == "--noise" )
+            {
+                scene_params.Noise() = std::stod( value );
+            }
+            else if( key == "--jitter" )
+            {
+                scene_params.Jitter() = std::stoi( value );
+            }
+            else if( key.compare( 0, 2, "--" ) == 0 )
+            {
+                std::cerr << "Unknown option '" << arg << "'." << std::endl;
+                return Usage();
+            }
+            else
+            {
+                params[ key ] = std::stod( value );
+                param_list << ( param_list.tellp() > 0 ? " " : "" ) << arg;
+            }
+        }
+    }
+    catch( const std::exception& )
+    {
+        // std::stoi(), std::stoull() and std::stod() throw on values that are not numbers
+        std::cerr << "Invalid value in '" << argv[ i ] << "'." << std::endl;
+        return Usage();
+    }
+
+    if( synthetic ? !files.empty() : files.size() != 2 || follow_camera )
+    {
+        return Usage();
+    }
+
+    // single channel models are fed grayscale frames
+    bool gray = params.count( "Channels" ) != 0 && params[ "Channels" ] == 1;
+
+    cv::VideoCapture clip_reader;
+    cv::VideoCapture truth_reader;
+    cv::Ptr< SyntheticScene > scene;
+    int width, height;
+
+    if( synthetic )
+    {
+        // synthetic scenes are rendered with the number of channels of the model
+        scene_params.Channels() = gray ? 1 : 3;
+        if( last < 0 )
+        {
+            last = 299;
+        }
+        scene = cv::makePtr< SyntheticScene >( scene_params );
+        width = scene_params.Width();
+        height = scene_params.Height();
+    }
+    else
+    {
+        clip_reader.open( files[ 0 ] );
+        truth_reader.open( files[ 1 ] );
+        if( !clip_reader.isOpened() || !truth_reader.isOpened() )
+        {
+            std::cerr << "Could not open " << ( clip_reader.isOpened() ? files[ 1 ] : files[ 0 ] ) << "." << std::endl;
+            return 1;
+        }
+
+        width = static_cast< int >( clip_reader.get( cv::CAP_PROP_FRAME_WIDTH ) );
+        height = static_cast< int >( clip_reader.get( cv::CAP_PROP_FRAME_HEIGHT ) );
+    }
+
+    cv::Ptr< Bgs > bgs;
+    try
+    {
+        bgs = createBgs( algorithm, width, height, params );
+        if( illumination >= 0 )
+        {
+            bgs = cv::makePtr< IlluminationBgs >( bgs, illumination );
+        }
+        if( frame_skip > 0 )
+        {
+            // motion gating at an L-inf difference of 15, as in the FrameSkipBgs example
+            bgs = cv::makePtr< FrameSkipBgs >( bgs, frame_skip, 15 );
+        }
+        if( warmup >= 0 )
+        {
+            bgs->SetLearningRateSchedule( LearningRateSchedule::WarmUp( warmup ) );
+        }
+    }
+    catch( const cv::Exception& e )
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    ConfusionMatrix confusion;
+    ImageDigest output_digest;
+    int64 ticks = 0;
+    int frames = 0;
+
+    cv::Mat frame;
+    cv::Mat truth_frame;
+    BwImage fgmask;
+    BwImage truth_mask;
+    for( int i = 0; last < 0 || i <= last; ++i )
+    {
+        if( scene )
+        {
+            BwImage scene_truth;
+            scene->Render( i, frame, scene_truth );
+            truth_frame = scene_truth;
+        }
+        else
+        {
+            clip_reader >> frame;
+            truth_reader >> truth_frame;
+            if( frame.empty() || truth_frame.empty() )
+            {
+                break;
+            }
+        }
+
+        if( gray && frame.channels() == 3 )
+        {
+            cv::cvtColor( frame, frame, cv::COLOR_BGR2GRAY );
+        }
+
+        int64 start = cv::getTickCount();
+        if( follow_camera && i > 0 )
+        {
+            bgs->WarpModel( scene->CameraMotion( i ) );
+        }
+        bgs->apply( frame, fgmask );
+        ticks += cv::getTickCount() - start;
+        ++frames;
+
+        if( digest )
+        {
+            cv::Mat background;
+            bgs->getBackgroundImage( background );
+            output_digest.Add( bgs->LowThresholdMask() );
+            output_digest.Add( bgs->HighThresholdMask() );
+            output_digest.Add( background );
+        }
+
+        if( i < first )
+        {
+            continue;
+        }
+
+        // image sequences of masks are usually decoded as color images
+        if( truth_frame.channels() == 3 )
+        {
+            cv::cvtColor( truth_frame, truth_mask, cv::COLOR_BGR2GRAY );
+        }
+        else
+        {
+            truth_mask = truth_frame;
+        }
+
+        if( truth_mask.size() != fgmask.size() )
+        {
+            std::cerr << "Ground truth of frame " << i << " does not have the size of the clip." << std::endl;
+            return 1;
+        }
+
+        confusion.Add( fgmask, truth_mask );
+    }
+
+    double fps = ticks == 0 ? 0 : frames * cv::getTickFrequency() / ticks;
+
+    if( csv )
+    {
+        std::cout << algorithm << "," << param_list.str() << "," << frames << ","
+                  << confusion.Precision() << "," << confusion.Recall() << "," << confusion.FMeasure() << ","
+                  << confusion.PWC() << "," << fps;
+        if( digest )
+        {
+            std::cout << "," << output_digest.Hex();
+        }
+        std::cout << std::endl;
+    }
+    else
+    {
+        std::cout << "Algorithm:  " << algorithm << " " << param_list.str() << std::endl;
+        std::cout << "Frames:     " << frames << " (scored from frame " << first << ")" << std::endl;
+        std::cout << "Precision:  " << confusion.Precision() << std::endl;
+        std::cout << "Recall:     " << confusion.Recall() << std::endl;
+        std::cout << "F-measure:  " << confusion.FMeasure() << std::endl;
+        std::cout << "PWC:        " << confusion.PWC() << " %" << std::endl;
+        std::cout << "FPS:        " << fps << std::endl;
+        std::cout << "CPU path:   " << CpuPathName( ActiveCpuPath() ) << std::endl;
+        if( digest )
+        {
+            std::cout << "Digest:     " << output_digest.Hex() << std::endl;
+        }
+    }
+
+    if( !expected.empty() && expected != output_digest.Hex() )
+    {
+        std::cerr << "Digest " << output_digest.Hex() << " differs from the expected " << expected << "." << std::endl;
+        return 2;
+    }
+
+    return 0;
+}
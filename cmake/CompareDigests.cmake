@@ -0,0 +1,33 @@
+# Test of an algorithm without a golden digest in GoldenDigests.cmake: reports whether an execution
+# mode reproduces the digest of the serial scalar baseline mode, then fails, since the output is
+# not checked against a recorded one until the bgs_golden target records it.
+#   cmake -DBGS_EVAL=<bgs_eval> -DALGORITHM=<name> "-DARGS=<scene options>" "-DMODE=<mode options>"
+#         -P CompareDigests.cmake
+SEPARATE_ARGUMENTS(BGS_SCENE_ARGS UNIX_COMMAND "${ARGS}")
+SEPARATE_ARGUMENTS(BGS_MODE_ARGS UNIX_COMMAND "${MODE}")
+
+FOREACH(RUN reference mode)
+    IF(RUN STREQUAL "reference")
+        SET(BGS_RUN_ARGS --threads=1 --no-simd --cpu=baseline)
+    ELSE()
+        SET(BGS_RUN_ARGS ${BGS_MODE_ARGS})
+    ENDIF()
+
+    EXECUTE_PROCESS(COMMAND ${BGS_EVAL} ${ALGORITHM} ${BGS_SCENE_ARGS} --csv --digest ${BGS_RUN_ARGS}
+        RESULT_VARIABLE BGS_EVAL_RESULT
+        OUTPUT_VARIABLE BGS_EVAL_OUTPUT
+        OUTPUT_STRIP_TRAILING_WHITESPACE)
+    IF(BGS_EVAL_RESULT EQUAL 77)
+        MESSAGE(STATUS "The processor does not support ${MODE}, not checked")
+        RETURN()
+    ELSEIF(BGS_EVAL_RESULT)
+        MESSAGE(FATAL_ERROR "bgs_eval ${ALGORITHM} ${BGS_RUN_ARGS} failed: ${BGS_EVAL_RESULT}")
+    ENDIF()
+    STRING(REGEX MATCH "[0-9a-f]+$" BGS_DIGEST_${RUN} "${BGS_EVAL_OUTPUT}")
+ENDFOREACH()
+
+IF(NOT BGS_DIGEST_mode STREQUAL BGS_DIGEST_reference)
+    MESSAGE(FATAL_ERROR "Digest ${BGS_DIGEST_mode} of ${MODE} differs from ${BGS_DIGEST_reference} of the reference mode")
+ENDIF()
+MESSAGE(FATAL_ERROR "No golden digest of ${ALGORITHM} in GoldenDigests.cmake (the reference mode gives "
+    "${BGS_DIGEST_reference}), record the digests with the bgs_golden target")
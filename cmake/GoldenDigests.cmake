@@ -0,0 +1,13 @@
+# Golden digests of bgs_eval --digest for each algorithm on the synthetic scene of BGS_GOLDEN_ARGS,
+# checked by the golden_* tests in every execution mode. The scene is rendered by OpenCV, so the
+# digests belong to an OpenCV version. Written by the bgs_golden target (RecordGoldenDigests.cmake);
+# record them again only after an intended change of the output of an algorithm. The tests of an
+# algorithm without a digest fail until one is recorded.
+SET(BGS_GOLDEN_ARGS --synthetic=320x240 --frames=60 --seed=7 --jitter=1)
+SET(BGS_GOLDEN_AdaptiveMedianBGS "")
+SET(BGS_GOLDEN_Eigenbackground "")
+SET(BGS_GOLDEN_GrimsonGMM "")
+SET(BGS_GOLDEN_MeanBGS "")
+SET(BGS_GOLDEN_PratiMediodBGS "")
+SET(BGS_GOLDEN_WrenGA "")
+SET(BGS_GOLDEN_ZivkovicAGMM "")
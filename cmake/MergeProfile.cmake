@@ -0,0 +1,12 @@
+# Merge the raw profiles written by a Clang instrumented build into the file used by BGS_PGO=USE.
+#   cmake -DLLVM_PROFDATA=<llvm-profdata> -DPGO_DIR=<profile directory> -P MergeProfile.cmake
+FILE(GLOB BGS_RAW_PROFILES "${PGO_DIR}/*.profraw")
+IF(NOT BGS_RAW_PROFILES)
+    MESSAGE(FATAL_ERROR "No raw profile in ${PGO_DIR}")
+ENDIF()
+
+EXECUTE_PROCESS(COMMAND ${LLVM_PROFDATA} merge -output=${PGO_DIR}/bgs.profdata ${BGS_RAW_PROFILES}
+    RESULT_VARIABLE BGS_MERGE_RESULT)
+IF(BGS_MERGE_RESULT)
+    MESSAGE(FATAL_ERROR "llvm-profdata failed: ${BGS_MERGE_RESULT}")
+ENDIF()
@@ -0,0 +1,25 @@
+# Record the golden digests of the algorithms in the serial scalar baseline mode and rewrite the
+# data file read by the golden_* tests.
+#   cmake -DBGS_EVAL=<bgs_eval> "-DARGS=<scene options>" "-DALGORITHMS=<names>" -DOUTPUT=<GoldenDigests.cmake>
+#         -P RecordGoldenDigests.cmake
+SEPARATE_ARGUMENTS(BGS_SCENE_ARGS UNIX_COMMAND "${ARGS}")
+SEPARATE_ARGUMENTS(BGS_ALGORITHMS UNIX_COMMAND "${ALGORITHMS}")
+
+FILE(READ ${OUTPUT} BGS_DIGESTS)
+FOREACH(ALGORITHM ${BGS_ALGORITHMS})
+    EXECUTE_PROCESS(COMMAND ${BGS_EVAL} ${ALGORITHM} ${BGS_SCENE_ARGS} --csv --digest --threads=1 --no-simd --cpu=baseline
+        RESULT_VARIABLE BGS_EVAL_RESULT
+        OUTPUT_VARIABLE BGS_EVAL_OUTPUT
+        OUTPUT_STRIP_TRAILING_WHITESPACE)
+    IF(BGS_EVAL_RESULT)
+        MESSAGE(FATAL_ERROR "bgs_eval ${ALGORITHM} failed: ${BGS_EVAL_RESULT}")
+    ENDIF()
+
+    # the digest is the last field of the line
+    STRING(REGEX MATCH "[0-9a-f]+$" BGS_DIGEST "${BGS_EVAL_OUTPUT}")
+    STRING(REGEX REPLACE "SET\\(BGS_GOLDEN_${ALGORITHM} \"[0-9a-f]*\"\\)" "SET(BGS_GOLDEN_${ALGORITHM} \"${BGS_DIGEST}\")"
+        BGS_DIGESTS "${BGS_DIGESTS}")
+    MESSAGE(STATUS "${ALGORITHM}: ${BGS_DIGEST}")
+ENDFOREACH()
+
+FILE(WRITE ${OUTPUT} "${BGS_DIGESTS}")
@@ -16,114 +16,98 @@
 ******************************************************************************/
 
 #include <iostream>
-#include <opencv2\videoio.hpp>
+#include <string>
+#include <opencv2/videoio.hpp>
+#include <opencv2/imgproc.hpp>
 
-#include "AdaptiveMedianBGS.hpp"
-#include "GrimsonGMM.hpp"
-#include "ZivkovicAGMM.hpp"
-#include "MeanBGS.hpp"
-#include "WrenGA.hpp"
-#include "PratiMediodBGS.hpp"
-#include "Eigenbackground.hpp"
+#include "BgsFactory.hpp"
+#include "SyntheticScene.hpp"
 
+namespace
+{
+    void    PrintLatency( const char* stage, const Algorithms::BackgroundSubtraction::LatencyHistogram& latency )
+    {
+        if( latency.Count() == 0 )
+            return;
+
+        std::cout << stage << ": mean " << latency.Mean() * 1e3 << " ms, p50 " << latency.Quantile( 0.5 ) * 1e3
+                  << " ms, p99 " << latency.Quantile( 0.99 ) * 1e3 << " ms, max " << latency.Max() * 1e3 << " ms" << std::endl;
+    }
+}
+
+// Usage: bgs_test [algorithm [parameter=value ...]]
 int     main( int argc, const char* argv[] )
 {
-    // read data from AVI file
-    cv::VideoCapture reader( "examples/fountain.avi" );
-    if( !reader.isOpened() )
+    std::string algorithm = argc > 1 ? argv[ 1 ] : "AdaptiveMedianBGS";
+
+    Algorithms::BackgroundSubtraction::BgsParamMap params;
+    for( int i = 2; i < argc; ++i )
     {
-        std::cerr << "Could not open AVI file." << std::endl;
-        return 0;
+        std::string arg = argv[ i ];
+        size_t equals = arg.find( '=' );
+        if( equals == std::string::npos )
+        {
+            std::cerr << "Expected parameter=value instead of '" << arg << "'." << std::endl;
+            return 1;
+        }
+        params[ arg.substr( 0, equals ) ] = std::stod( arg.substr( equals + 1 ) );
     }
 
-    // retrieve information about AVI file
-    int width = static_cast< int >( reader.get( cv::CAP_PROP_FRAME_WIDTH ) );
-    int height = static_cast< int >( reader.get( cv::CAP_PROP_FRAME_HEIGHT ) );
-    double fps = reader.get( cv::CAP_PROP_FPS );
-    unsigned int num_frames = static_cast< unsigned int >( reader.get( cv::CAP_PROP_FRAME_COUNT ) );
+    // single channel models are fed grayscale frames
+    bool gray = params.count( "Channels" ) != 0 && params[ "Channels" ] == 1;
+
+    // read data from AVI file, or render a synthetic scene if it is missing
+    cv::VideoCapture reader( "examples/fountain.avi" );
+    cv::Ptr< Algorithms::BackgroundSubtraction::SyntheticScene > scene;
+    int width, height;
+    double fps;
+    unsigned int num_frames;
+    if( reader.isOpened() )
+    {
+        // retrieve information about AVI file
+        width = static_cast< int >( reader.get( cv::CAP_PROP_FRAME_WIDTH ) );
+        height = static_cast< int >( reader.get( cv::CAP_PROP_FRAME_HEIGHT ) );
+        fps = reader.get( cv::CAP_PROP_FPS );
+        num_frames = static_cast< unsigned int >( reader.get( cv::CAP_PROP_FRAME_COUNT ) );
+    }
+    else
+    {
+        std::cout << "Could not open AVI file, using a synthetic scene." << std::endl;
+
+        Algorithms::BackgroundSubtraction::SyntheticSceneParams scene_params;
+        scene_params.Channels() = gray ? 1 : 3;
+        scene = cv::makePtr< Algorithms::BackgroundSubtraction::SyntheticScene >( scene_params );
+        width = scene_params.Width();
+        height = scene_params.Height();
+        fps = 30;
+        num_frames = 300;
+    }
 
     // setup writer:
-    cv::VideoWriter writer( "output/results.avi", -1, fps, cv::Size( width, height ), false );
+    cv::VideoWriter writer( "output/results.avi", cv::VideoWriter::fourcc( 'M', 'J', 'P', 'G' ), fps, cv::Size( width, height ), false );
 
     // setup background subtraction algorithm
-    auto bgs = Algorithms::BackgroundSubtraction::createAdaptiveMedianBGS();
-
-    /*
-    Algorithms::BackgroundSubtraction::GrimsonParams params;
-    params.SetFrameSize(width, height);
-    params.LowThreshold() = 3.0f*3.0f;
-    params.HighThreshold() = 2*params.LowThreshold();	// Note: high threshold is used by post-processing
-    params.Alpha() = 0.001f;
-    params.MaxModes() = 3;
-
-    Algorithms::BackgroundSubtraction::GrimsonGMM bgs;
-    bgs.Initalize(params);
-    //*/
-
-    /*
-    Algorithms::BackgroundSubtraction::ZivkovicParams params;
-    params.SetFrameSize(width, height);
-    params.LowThreshold() = 5.0f*5.0f;
-    params.HighThreshold() = 2*params.LowThreshold();	// Note: high threshold is used by post-processing
-    params.Alpha() = 0.001f;
-    params.MaxModes() = 3;
-
-    Algorithms::BackgroundSubtraction::ZivkovicAGMM bgs;
-    bgs.Initalize(params);
-    //*/
-
-    /*
-    Algorithms::BackgroundSubtraction::MeanParams params;
-    params.SetFrameSize(width, height);
-    params.LowThreshold() = 3*30*30;
-    params.HighThreshold() = 2*params.LowThreshold();	// Note: high threshold is used by post-processing
-    params.Alpha() = 1e-6f;
-    params.LearningFrames() = 30;
-
-    Algorithms::BackgroundSubtraction::MeanBGS bgs;
-    bgs.Initalize(params);
-    //*/
-
-    /*
-    Algorithms::BackgroundSubtraction::WrenParams params;
-    params.SetFrameSize(width, height);
-    params.LowThreshold() = 3.5f*3.5f;
-    params.HighThreshold() = 2*params.LowThreshold();	// Note: high threshold is used by post-processing
-    params.Alpha() = 0.005f;
-    params.LearningFrames() = 30;
-
-    Algorithms::BackgroundSubtraction::WrenGA bgs;
-    bgs.Initalize(params);
-    //*/
-
-    /*
-    Algorithms::BackgroundSubtraction::PratiParams params;
-    params.SetFrameSize( width, height );
-    params.LowThreshold() = 30;
-    params.HighThreshold() = 2 * params.LowThreshold();	// Note: high threshold is used by post-processing 
-    params.SamplingRate() = 5;
-    params.HistorySize() = 16;
-    params.Weight() = 5;
-
-    Algorithms::BackgroundSubtraction::PratiMediodBGS bgs;
-    bgs.Initalize( params );
-    //*/
-
-    /*
-    Algorithms::BackgroundSubtraction::EigenbackgroundParams params;
-    params.SetFrameSize(width, height);
-    params.LowThreshold() = 15*15;
-    params.HighThreshold() = 2*params.LowThreshold();	// Note: high threshold is used by post-processing
-    params.HistorySize() = 100;
-    params.EmbeddedDim() = 20;
-
-    Algorithms::BackgroundSubtraction::Eigenbackground bgs;
-    bgs.Initalize(params);
-    //*/
+    cv::Ptr< Algorithms::BackgroundSubtraction::Bgs > bgs;
+    try
+    {
+        bgs = Algorithms::BackgroundSubtraction::createBgs( algorithm, width, height, params );
+    }
+    catch( const cv::Exception& e )
+    {
+        std::cerr << e.what() << std::endl << "Available algorithms:";
+        for( const std::string& name : Algorithms::BackgroundSubtraction::getBgsNames() )
+        {
+            std::cerr << " " << name;
+        }
+        std::cerr << std::endl;
+        return 1;
+    }
+
+    bgs->EnableStats( true );
 
     // perform background subtraction of each frame
     // setup buffer to hold individual frames from video stream
-    RgbImage frame_data;
+    cv::Mat frame_data;
     for( unsigned int i = 0; i < num_frames - 1; ++i )
     {
         if( i % 100 == 0 )
@@ -132,11 +116,23 @@ int     main( int argc, const char* argv[] )
         }
 
         // grad next frame from input video stream
-        reader >> frame_data;
-        if( frame_data.empty() )
+        if( scene )
         {
-            std::cerr << "Could not grab AVI frame." << std::endl;
-            return 0;
+            BwImage truth;
+            scene->Next( frame_data, truth );
+        }
+        else
+        {
+            reader >> frame_data;
+            if( frame_data.empty() )
+            {
+                std::cerr << "Could not grab AVI frame." << std::endl;
+                return 0;
+            }
+        }
+        if( gray && frame_data.channels() == 3 )
+        {
+            cv::cvtColor( frame_data, frame_data, cv::COLOR_BGR2GRAY );
         }
 
         // setup marks to hold results of low thresholding
@@ -149,5 +145,16 @@ int     main( int argc, const char* argv[] )
         writer.write( low_threshold_mask );
     }
 
+    Algorithms::BackgroundSubtraction::BgsStats stats = bgs->GetStats();
+    PrintLatency( "Frame", stats.frame );
+    PrintLatency( "Subtract", stats.subtract );
+    PrintLatency( "Update", stats.update );
+    PrintLatency( "Post-processing", stats.post_process );
+    if( stats.modes.matched + stats.modes.added > 0 )
+    {
+        std::cout << "Modes: " << stats.modes.matched << " matched, " << stats.modes.added << " added, "
+                  << stats.modes.replaced << " replaced, " << stats.modes.pruned << " pruned" << std::endl;
+    }
+
     return 0;
 }